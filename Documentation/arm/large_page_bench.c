@@ -0,0 +1,220 @@
+/*
+ * large_page_bench.c: measure the cost of TLB misses on an ION carveout
+ * buffer mapped with 64K large pages and with 4K pages.
+ *
+ * The buffer is allocated from ION, mapped, and read one word per 4K page
+ * in a random page order. The 32 entry TLBs of the Cortex-A8 cover 128K
+ * with 4K pages but 2MB with large pages, so for buffer sizes in between
+ * nearly every access needs a page table walk with 4K pages, and almost
+ * none does with large pages. The time per access is printed for two
+ * mappings of the same buffer:
+ *
+ *	large	placed by the kernel, at the same offset into a 64K block
+ *		as the memory, so that it is mapped with large pages
+ *	small	placed one page off that offset with MAP_FIXED, so that no
+ *		64K block lines up and it is mapped with 4K pages
+ *
+ * Carveout mappings are uncached, so every access goes to memory: the
+ * difference between the two is the cost of the page table walks. With
+ * -a, an anonymous buffer of the same size is measured as well, for
+ * reference.
+ *
+ *	large_page_bench -k 1024 -H 4
+ *
+ * -H is the mask of ION heap ids to allocate from. The default of 4 is
+ * heap id 2, the carveout heap on OMAP3 (see arch/arm/mach-omap2/omap_ion.c).
+ *
+ * Build with:	arm-linux-gnueabi-gcc -O2 -static -o large_page_bench large_page_bench.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+/* From include/linux/ion.h, which is not exported to userspace */
+struct ion_allocation_data {
+	size_t len;
+	size_t align;
+	unsigned int flags;
+	void *handle;
+};
+
+struct ion_fd_data {
+	void *handle;
+	int fd;
+	unsigned char cacheable;
+};
+
+struct ion_handle_data {
+	void *handle;
+};
+
+#define ION_IOC_MAGIC		'I'
+#define ION_IOC_ALLOC		_IOWR(ION_IOC_MAGIC, 0, struct ion_allocation_data)
+#define ION_IOC_FREE		_IOWR(ION_IOC_MAGIC, 1, struct ion_handle_data)
+#define ION_IOC_SHARE		_IOWR(ION_IOC_MAGIC, 4, struct ion_fd_data)
+
+#define LARGE_PAGE_SIZE		(64 * 1024)
+
+static long page_size;
+static long *order;
+static volatile unsigned int sink;
+
+static double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Average ns per access over @passes walks of @nr pages of @buf */
+static double walk(volatile unsigned char *buf, long nr, int passes)
+{
+	unsigned int sum = 0;
+	double start;
+	long i;
+	int p;
+
+	/* Fault everything in first */
+	for (i = 0; i < nr; i++)
+		sum += buf[i * page_size];
+
+	start = now_ns();
+	for (p = 0; p < passes; p++)
+		for (i = 0; i < nr; i++)
+			sum += buf[order[i] * page_size];
+	sink = sum;
+	return (now_ns() - start) / ((double)nr * passes);
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "usage: %s [-k buffer_kb] [-p passes] [-H heap_mask] "
+		"[-a]\n", prog);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	struct ion_allocation_data alloc;
+	struct ion_handle_data free_data;
+	struct ion_fd_data share;
+	long size_kb = 1024, nr, i, j, t;
+	unsigned int heap_mask = 4;
+	int passes = 1000, anon = 0, ion, opt;
+	unsigned char *large, *small, *hint, *buf;
+	size_t size;
+
+	while ((opt = getopt(argc, argv, "k:p:H:a")) != -1) {
+		switch (opt) {
+		case 'k':
+			size_kb = atol(optarg);
+			break;
+		case 'p':
+			passes = atoi(optarg);
+			break;
+		case 'H':
+			heap_mask = strtoul(optarg, NULL, 0);
+			break;
+		case 'a':
+			anon = 1;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (size_kb <= 0 || passes <= 0)
+		usage(argv[0]);
+
+	page_size = sysconf(_SC_PAGESIZE);
+	size = (size_t)size_kb << 10;
+	nr = size / page_size;
+	if (!nr)
+		usage(argv[0]);
+
+	/* A random page order, so that prefetching does not help */
+	order = malloc(nr * sizeof(*order));
+	for (i = 0; i < nr; i++)
+		order[i] = i;
+	srandom(1);
+	for (i = nr - 1; i > 0; i--) {
+		j = random() % (i + 1);
+		t = order[i];
+		order[i] = order[j];
+		order[j] = t;
+	}
+
+	ion = open("/dev/ion", O_RDONLY);
+	if (ion < 0) {
+		perror("/dev/ion");
+		return 1;
+	}
+	memset(&alloc, 0, sizeof(alloc));
+	alloc.len = size;
+	alloc.align = LARGE_PAGE_SIZE;
+	alloc.flags = heap_mask;
+	if (ioctl(ion, ION_IOC_ALLOC, &alloc)) {
+		perror("ION_IOC_ALLOC");
+		return 1;
+	}
+	memset(&share, 0, sizeof(share));
+	share.handle = alloc.handle;
+	if (ioctl(ion, ION_IOC_SHARE, &share)) {
+		perror("ION_IOC_SHARE");
+		return 1;
+	}
+
+	large = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+		     share.fd, 0);
+	if (large == MAP_FAILED) {
+		perror("mmap");
+		return 1;
+	}
+	printf("%-6s %10.1f ns per access\n", "large",
+	       walk(large, nr, passes));
+	munmap(large, size);
+
+	/* Find room for the buffer, then map it one page past a 64K block */
+	hint = mmap(NULL, size + LARGE_PAGE_SIZE, PROT_NONE,
+		    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (hint == MAP_FAILED) {
+		perror("mmap");
+		return 1;
+	}
+	small = (unsigned char *)(((unsigned long)hint + LARGE_PAGE_SIZE - 1) &
+				  ~(LARGE_PAGE_SIZE - 1UL)) + page_size;
+	small = mmap(small, size, PROT_READ | PROT_WRITE,
+		     MAP_SHARED | MAP_FIXED, share.fd, 0);
+	if (small == MAP_FAILED) {
+		perror("mmap");
+		return 1;
+	}
+	printf("%-6s %10.1f ns per access\n", "small",
+	       walk(small, nr, passes));
+	munmap(hint, size + LARGE_PAGE_SIZE);
+
+	if (anon) {
+		buf = mmap(NULL, size, PROT_READ | PROT_WRITE,
+			   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (buf == MAP_FAILED) {
+			perror("mmap");
+			return 1;
+		}
+		memset(buf, 1, size);
+		printf("%-6s %10.1f ns per access\n", "anon",
+		       walk(buf, nr, passes));
+		munmap(buf, size);
+	}
+
+	close(share.fd);
+	free_data.handle = alloc.handle;
+	ioctl(ion, ION_IOC_FREE, &free_data);
+	close(ion);
+	return 0;
+}
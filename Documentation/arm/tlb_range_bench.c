@@ -0,0 +1,148 @@
+/*
+ * tlb_range_bench.c: measure munmap() and mprotect() of ranges of various
+ * sizes, which is mostly the cost of flush_tlb_range() once the pages
+ * have been touched.
+ *
+ * For each range size an anonymous mapping is created and every page of
+ * it written, then the time of
+ *
+ *	mprotect	making the range read-only, and writable again
+ *	munmap		unmapping the range
+ *
+ * is averaged over a number of rounds and printed in microseconds per
+ * call. Ranges of up to 64 pages are flushed page by page on ARMv7, larger
+ * ones by ASID, so the interesting sizes are on both sides of that. With
+ * -t, a second thread of the process spins on another CPU, so that on SMP
+ * the flushes also have to reach that CPU:
+ *
+ *	tlb_range_bench -r 200
+ *	tlb_range_bench -r 200 -t
+ *
+ * Build with:	arm-linux-gnueabi-gcc -O2 -static -o tlb_range_bench tlb_range_bench.c -lpthread
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/mman.h>
+
+static const long range_pages[] = {
+	1, 4, 16, 64, 65, 256, 1024, 4096, 16384,
+};
+#define NR_RANGES	(sizeof(range_pages) / sizeof(range_pages[0]))
+
+static long page_size;
+static volatile int stop;
+
+static double now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void *spin(void *arg)
+{
+	while (!stop)
+		;
+	return NULL;
+}
+
+static char *map_and_touch(size_t size)
+{
+	char *p;
+	size_t i;
+
+	p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+		 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED) {
+		perror("mmap");
+		exit(1);
+	}
+	for (i = 0; i < size; i += page_size)
+		p[i] = 1;
+	return p;
+}
+
+static void bench_range(long pages, int rounds)
+{
+	size_t size = pages * page_size;
+	double mprotect_us = 0, munmap_us = 0, start;
+	size_t i;
+	char *p;
+	int r;
+
+	for (r = 0; r < rounds; r++) {
+		p = map_and_touch(size);
+
+		start = now_us();
+		if (mprotect(p, size, PROT_READ) ||
+		    mprotect(p, size, PROT_READ | PROT_WRITE)) {
+			perror("mprotect");
+			exit(1);
+		}
+		mprotect_us += now_us() - start;
+
+		/* Bring the TLB entries back for munmap to flush */
+		for (i = 0; i < size; i += page_size)
+			p[i] = 2;
+
+		start = now_us();
+		if (munmap(p, size)) {
+			perror("munmap");
+			exit(1);
+		}
+		munmap_us += now_us() - start;
+	}
+
+	printf("%8ld %12.2f %12.2f\n", pages, mprotect_us / (2 * rounds),
+	       munmap_us / rounds);
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "usage: %s [-r rounds] [-t]\n", prog);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	int rounds = 100, thread = 0, opt;
+	pthread_t tid;
+	unsigned int i;
+
+	while ((opt = getopt(argc, argv, "r:t")) != -1) {
+		switch (opt) {
+		case 'r':
+			rounds = atoi(optarg);
+			break;
+		case 't':
+			thread = 1;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (rounds <= 0)
+		usage(argv[0]);
+
+	page_size = sysconf(_SC_PAGESIZE);
+	if (thread && pthread_create(&tid, NULL, spin, NULL)) {
+		perror("pthread_create");
+		return 1;
+	}
+
+	printf("%8s %12s %12s\n", "pages", "mprotect_us", "munmap_us");
+	for (i = 0; i < NR_RANGES; i++)
+		bench_range(range_pages[i], rounds);
+
+	if (thread) {
+		stop = 1;
+		pthread_join(tid, NULL);
+	}
+	return 0;
+}
@@ -0,0 +1,171 @@
+/*
+ * uaccess_bench.c: measure read() and write() throughput, which is mostly
+ * the cost of copy_to_user() and copy_from_user() for large calls.
+ *
+ * For every size from 64 bytes to 1MB it times
+ *
+ *	write	pwrite() of the buffer to a file
+ *	read	pread() of the buffer from the same file, cached
+ *	pipe	write() to a pipe, with a child process reading it
+ *
+ * and prints MB/s for each. The file should be on tmpfs, so that the
+ * copies are all there is to the calls. To compare the NEON user copies
+ * (CONFIG_NEON_UACCESS) with the integer ones, run it once as is and once
+ * after booting with "neon_copy_threshold=0":
+ *
+ *	uaccess_bench /dev/shm/uaccess_bench
+ *
+ * Build with:	arm-linux-gnueabi-gcc -O2 -static -o uaccess_bench uaccess_bench.c
+ * Run as:	uaccess_bench [-m total_mb] [file]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/wait.h>
+
+#define MIN_SIZE	64
+#define MAX_SIZE	(1024 * 1024)
+
+static long total_mb = 64;
+static char *buf;
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static long loops_for(size_t size)
+{
+	long loops = (total_mb << 20) / size;
+
+	return loops ? loops : 1;
+}
+
+static double bench_file(int fd, size_t size, int do_write)
+{
+	long i, loops = loops_for(size);
+	double start;
+	ssize_t ret;
+
+	start = now();
+	for (i = 0; i < loops; i++) {
+		if (do_write)
+			ret = pwrite(fd, buf, size, 0);
+		else
+			ret = pread(fd, buf, size, 0);
+		if (ret != size) {
+			perror(do_write ? "pwrite" : "pread");
+			exit(1);
+		}
+	}
+	return (double)loops * size / (now() - start) / (1 << 20);
+}
+
+static void pipe_reader(int fd, size_t size)
+{
+	char *rbuf = malloc(size);
+
+	while (read(fd, rbuf, size) > 0)
+		;
+	_exit(0);
+}
+
+static double bench_pipe(size_t size)
+{
+	long i, loops = loops_for(size);
+	size_t done;
+	double start;
+	ssize_t ret;
+	int fds[2];
+	pid_t pid;
+
+	if (pipe(fds)) {
+		perror("pipe");
+		exit(1);
+	}
+	pid = fork();
+	if (pid < 0) {
+		perror("fork");
+		exit(1);
+	}
+	if (!pid) {
+		close(fds[1]);
+		pipe_reader(fds[0], size);
+	}
+	close(fds[0]);
+
+	start = now();
+	for (i = 0; i < loops; i++)
+		for (done = 0; done < size; done += ret) {
+			ret = write(fds[1], buf + done, size - done);
+			if (ret <= 0) {
+				perror("write");
+				exit(1);
+			}
+		}
+	close(fds[1]);
+	waitpid(pid, NULL, 0);
+	return (double)loops * size / (now() - start) / (1 << 20);
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "usage: %s [-m total_mb] [file]\n", prog);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	const char *path = "/dev/shm/uaccess_bench";
+	double w, r, p;
+	size_t size;
+	int fd, opt;
+
+	while ((opt = getopt(argc, argv, "m:")) != -1) {
+		switch (opt) {
+		case 'm':
+			total_mb = atol(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (total_mb <= 0 || optind < argc - 1)
+		usage(argv[0]);
+	if (optind < argc)
+		path = argv[optind];
+
+	buf = malloc(MAX_SIZE);
+	if (!buf) {
+		perror("malloc");
+		return 1;
+	}
+	memset(buf, 0x5a, MAX_SIZE);
+
+	fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if (fd < 0) {
+		perror(path);
+		return 1;
+	}
+	unlink(path);
+	signal(SIGPIPE, SIG_IGN);
+
+	printf("%8s %10s %10s %10s\n", "size", "write", "read", "pipe");
+	for (size = MIN_SIZE; size <= MAX_SIZE; size <<= 2) {
+		/* The file has to be written before it can be read */
+		w = bench_file(fd, size, 1);
+		r = bench_file(fd, size, 0);
+		p = bench_pipe(size);
+		printf("%8zu %10.1f %10.1f %10.1f\n", size, w, r, p);
+	}
+	close(fd);
+	return 0;
+}
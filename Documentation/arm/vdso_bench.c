@@ -0,0 +1,192 @@
+/*
+ * vdso_bench.c: compare clock_gettime() and gettimeofday() through the
+ * system calls with the vDSO entry points (CONFIG_VDSO).
+ *
+ * The vDSO is located through the AT_SYSINFO_EHDR entry of
+ * /proc/self/auxv, and its symbols are looked up in its dynamic symbol
+ * table, so this works with C libraries that do not use the vDSO.
+ *
+ * Build with:	arm-linux-gnueabi-gcc -O2 -static -o vdso_bench vdso_bench.c
+ * Run as:	vdso_bench [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <elf.h>
+#include <sys/time.h>
+#include <sys/syscall.h>
+
+#ifndef AT_SYSINFO_EHDR
+#define AT_SYSINFO_EHDR	33
+#endif
+
+typedef int (*clock_gettime_t)(clockid_t, struct timespec *);
+typedef int (*gettimeofday_t)(struct timeval *, struct timezone *);
+
+static unsigned long vdso_base(void)
+{
+	unsigned long auxv[2];
+	unsigned long base = 0;
+	int fd;
+
+	fd = open("/proc/self/auxv", O_RDONLY);
+	if (fd < 0)
+		return 0;
+	while (read(fd, auxv, sizeof(auxv)) == sizeof(auxv)) {
+		if (auxv[0] == AT_SYSINFO_EHDR) {
+			base = auxv[1];
+			break;
+		}
+		if (auxv[0] == AT_NULL)
+			break;
+	}
+	close(fd);
+	return base;
+}
+
+static void *vdso_sym(unsigned long base, const char *name)
+{
+	Elf32_Ehdr *ehdr = (Elf32_Ehdr *)base;
+	Elf32_Phdr *phdr = (Elf32_Phdr *)(base + ehdr->e_phoff);
+	Elf32_Dyn *dyn = NULL;
+	Elf32_Sym *symtab = NULL;
+	Elf32_Word *hash = NULL;
+	const char *strtab = NULL;
+	unsigned long load = base;
+	unsigned int i;
+
+	for (i = 0; i < ehdr->e_phnum; i++) {
+		if (phdr[i].p_type == PT_LOAD)
+			load = base + phdr[i].p_offset - phdr[i].p_vaddr;
+		else if (phdr[i].p_type == PT_DYNAMIC)
+			dyn = (Elf32_Dyn *)(base + phdr[i].p_offset);
+	}
+	if (!dyn)
+		return NULL;
+
+	for (; dyn->d_tag != DT_NULL; dyn++) {
+		if (dyn->d_tag == DT_SYMTAB)
+			symtab = (Elf32_Sym *)(load + dyn->d_un.d_ptr);
+		else if (dyn->d_tag == DT_STRTAB)
+			strtab = (const char *)(load + dyn->d_un.d_ptr);
+		else if (dyn->d_tag == DT_HASH)
+			hash = (Elf32_Word *)(load + dyn->d_un.d_ptr);
+	}
+	if (!symtab || !strtab || !hash)
+		return NULL;
+
+	/* The second word of the hash table is the number of symbols */
+	for (i = 0; i < hash[1]; i++) {
+		if (symtab[i].st_shndx == SHN_UNDEF ||
+		    ELF32_ST_TYPE(symtab[i].st_info) != STT_FUNC)
+			continue;
+		if (!strcmp(strtab + symtab[i].st_name, name))
+			return (void *)(load + symtab[i].st_value);
+	}
+	return NULL;
+}
+
+static int sys_clock_gettime(clockid_t clk, struct timespec *ts)
+{
+	return syscall(__NR_clock_gettime, clk, ts);
+}
+
+static int sys_gettimeofday(struct timeval *tv, struct timezone *tz)
+{
+	return syscall(__NR_gettimeofday, tv, tz);
+}
+
+static double now_ns(void)
+{
+	struct timespec ts;
+
+	sys_clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static double bench_clock(clock_gettime_t fn, clockid_t clk, long loops)
+{
+	struct timespec ts;
+	double start = now_ns();
+	long i;
+
+	for (i = 0; i < loops; i++)
+		fn(clk, &ts);
+	return (now_ns() - start) / loops;
+}
+
+static double bench_tod(gettimeofday_t fn, long loops)
+{
+	struct timeval tv;
+	double start = now_ns();
+	long i;
+
+	for (i = 0; i < loops; i++)
+		fn(&tv, NULL);
+	return (now_ns() - start) / loops;
+}
+
+/* The vDSO and the system call must agree, and time must not go back */
+static int check(clock_gettime_t vdso_cgt, clockid_t clk)
+{
+	struct timespec a, b, c;
+	int i;
+
+	for (i = 0; i < 100000; i++) {
+		sys_clock_gettime(clk, &a);
+		vdso_cgt(clk, &b);
+		sys_clock_gettime(clk, &c);
+		if (b.tv_sec < a.tv_sec ||
+		    (b.tv_sec == a.tv_sec && b.tv_nsec < a.tv_nsec) ||
+		    c.tv_sec < b.tv_sec ||
+		    (c.tv_sec == b.tv_sec && c.tv_nsec < b.tv_nsec)) {
+			fprintf(stderr, "clock %d out of order: "
+				"%ld.%09ld %ld.%09ld %ld.%09ld\n", (int)clk,
+				(long)a.tv_sec, a.tv_nsec,
+				(long)b.tv_sec, b.tv_nsec,
+				(long)c.tv_sec, c.tv_nsec);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	long loops = argc > 1 ? atol(argv[1]) : 1000000;
+	clock_gettime_t vdso_cgt;
+	gettimeofday_t vdso_gtod;
+	unsigned long base;
+
+	base = vdso_base();
+	if (!base) {
+		fprintf(stderr, "no vDSO (AT_SYSINFO_EHDR) in auxv\n");
+		return 1;
+	}
+	vdso_cgt = vdso_sym(base, "__vdso_clock_gettime");
+	vdso_gtod = vdso_sym(base, "__vdso_gettimeofday");
+	if (!vdso_cgt || !vdso_gtod) {
+		fprintf(stderr, "vDSO symbols not found\n");
+		return 1;
+	}
+
+	if (check(vdso_cgt, CLOCK_REALTIME) ||
+	    check(vdso_cgt, CLOCK_MONOTONIC))
+		return 1;
+
+	printf("%-32s %10s %10s\n", "ns per call", "syscall", "vdso");
+	printf("%-32s %10.1f %10.1f\n", "clock_gettime(CLOCK_REALTIME)",
+	       bench_clock(sys_clock_gettime, CLOCK_REALTIME, loops),
+	       bench_clock(vdso_cgt, CLOCK_REALTIME, loops));
+	printf("%-32s %10.1f %10.1f\n", "clock_gettime(CLOCK_MONOTONIC)",
+	       bench_clock(sys_clock_gettime, CLOCK_MONOTONIC, loops),
+	       bench_clock(vdso_cgt, CLOCK_MONOTONIC, loops));
+	printf("%-32s %10.1f %10.1f\n", "gettimeofday()",
+	       bench_tod(sys_gettimeofday, loops),
+	       bench_tod(vdso_gtod, loops));
+	return 0;
+}
@@ -0,0 +1,182 @@
+/*
+ * wakeup_latency.c: measure how late a periodic task is woken up while
+ * CPU bound tasks keep the CPUs busy, cyclictest style, to compare
+ * cpu.latency settings of CPU cgroups (see sched-design-CFS.txt).
+ *
+ * A measuring thread sleeps until an absolute deadline every interval and
+ * records how late it actually ran. Busy looping background threads are
+ * started next to it. With -f and -b, the measuring thread and the
+ * background threads are moved to the given cgroup directories, and -l
+ * writes cpu.latency of the foreground group first:
+ *
+ *	mount -t cgroup -o cpu none /dev/cpuctl
+ *	mkdir /dev/cpuctl/fg /dev/cpuctl/bg
+ *	wakeup_latency -f /dev/cpuctl/fg -b /dev/cpuctl/bg -l 0
+ *	wakeup_latency -f /dev/cpuctl/fg -b /dev/cpuctl/bg -l 100000
+ *
+ * Build with:	gcc -O2 -o wakeup_latency wakeup_latency.c -lpthread -lrt
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/syscall.h>
+
+#define NSEC_PER_SEC	1000000000LL
+#define NR_BUCKETS	20	/* power of two microsecond buckets */
+
+static long interval_us = 1000;
+static long duration_s = 10;
+static int nr_hogs = 2;
+static const char *fg_group, *bg_group;
+static volatile int stop;
+
+static long long ts_ns(const struct timespec *ts)
+{
+	return ts->tv_sec * NSEC_PER_SEC + ts->tv_nsec;
+}
+
+static void write_file(const char *dir, const char *file, long long val)
+{
+	char path[256], buf[32];
+	int fd, len;
+
+	snprintf(path, sizeof(path), "%s/%s", dir, file);
+	fd = open(path, O_WRONLY);
+	len = snprintf(buf, sizeof(buf), "%lld\n", val);
+	if (fd < 0 || write(fd, buf, len) != len) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		exit(1);
+	}
+	close(fd);
+}
+
+/* Move the calling thread to cgroup @dir */
+static void join_group(const char *dir)
+{
+	if (dir)
+		write_file(dir, "tasks", syscall(__NR_gettid));
+}
+
+static void *hog(void *arg)
+{
+	volatile unsigned long n = 0;
+
+	join_group(bg_group);
+	while (!stop)
+		n++;
+	return NULL;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "usage: %s [-i interval_us] [-d duration_s] "
+		"[-n background_threads]\n"
+		"\t[-f foreground_cgroup] [-b background_cgroup] "
+		"[-l foreground_cpu.latency_ns]\n", prog);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	long long latency = -1, lat, sum = 0, max = 0, min = -1;
+	unsigned long hist[NR_BUCKETS] = { 0 }, count = 0, acc;
+	struct timespec next, now;
+	long long end;
+	pthread_t *hogs;
+	int i, opt;
+
+	while ((opt = getopt(argc, argv, "i:d:n:f:b:l:")) != -1) {
+		switch (opt) {
+		case 'i':
+			interval_us = atol(optarg);
+			break;
+		case 'd':
+			duration_s = atol(optarg);
+			break;
+		case 'n':
+			nr_hogs = atoi(optarg);
+			break;
+		case 'f':
+			fg_group = optarg;
+			break;
+		case 'b':
+			bg_group = optarg;
+			break;
+		case 'l':
+			latency = atoll(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (interval_us <= 0 || duration_s <= 0 || nr_hogs < 0)
+		usage(argv[0]);
+
+	if (latency >= 0) {
+		if (!fg_group)
+			usage(argv[0]);
+		write_file(fg_group, "cpu.latency", latency);
+	}
+	join_group(fg_group);
+
+	hogs = calloc(nr_hogs, sizeof(*hogs));
+	for (i = 0; i < nr_hogs; i++)
+		if (pthread_create(&hogs[i], NULL, hog, NULL)) {
+			perror("pthread_create");
+			return 1;
+		}
+
+	clock_gettime(CLOCK_MONOTONIC, &next);
+	end = ts_ns(&next) + duration_s * NSEC_PER_SEC;
+	for (;;) {
+		next.tv_nsec += interval_us * 1000;
+		while (next.tv_nsec >= NSEC_PER_SEC) {
+			next.tv_nsec -= NSEC_PER_SEC;
+			next.tv_sec++;
+		}
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+		clock_gettime(CLOCK_MONOTONIC, &now);
+
+		lat = ts_ns(&now) - ts_ns(&next);
+		sum += lat;
+		if (lat > max)
+			max = lat;
+		if (min < 0 || lat < min)
+			min = lat;
+		for (i = 0; i < NR_BUCKETS - 1 && (lat / 1000) >> i; i++)
+			;
+		hist[i]++;
+		count++;
+
+		if (ts_ns(&now) >= end)
+			break;
+		/* Don't try to catch up after a long delay */
+		if (ts_ns(&now) > ts_ns(&next) + interval_us * 1000LL)
+			next = now;
+	}
+
+	stop = 1;
+	for (i = 0; i < nr_hogs; i++)
+		pthread_join(hogs[i], NULL);
+
+	printf("wakeups %lu, latency min %lld us, avg %lld us, max %lld us\n",
+	       count, min / 1000, sum / (long long)count / 1000, max / 1000);
+	printf("%12s %10s %8s\n", "latency_us", "count", "cumul%");
+	for (i = 0, acc = 0; i < NR_BUCKETS; i++) {
+		if (!hist[i])
+			continue;
+		acc += hist[i];
+		printf("%4s %7ld %10lu %7.2f%%\n",
+		       i < NR_BUCKETS - 1 ? "<" : ">=",
+		       i < NR_BUCKETS - 1 ? 1L << i : 1L << (i - 1),
+		       hist[i], 100.0 * acc / count);
+	}
+	return 0;
+}
@@ -0,0 +1,171 @@
+/*
+ * ra_pattern_bench.c: measure recorded readahead pattern replay.
+ *
+ * The file is mmapped and a fixed random set of its pages is touched,
+ * the way a launching app touches its APK and odex files, with the page
+ * cache dropped before every pass:
+ *
+ *	cold	no pattern exists
+ *	record	POSIX_FADV_RA_RECORD is set while touching
+ *	open	the pattern is replayed by open(), in the background
+ *	fadvise	the pattern is replayed by POSIX_FADV_RA_REPLAY
+ *
+ * Each pass prints its time and the number of major faults. A file on a
+ * loop device shows the effect of batching without a real eMMC at hand;
+ * dropping all caches (which needs root) also empties the page cache of
+ * the backing file, so that the loop device has to read it again:
+ *
+ *	dd if=/dev/zero of=/data/ra.img bs=1M count=128
+ *	losetup /dev/block/loop0 /data/ra.img
+ *	mkfs.ext2 /dev/block/loop0
+ *	mount -t ext2 /dev/block/loop0 /mnt
+ *	dd if=/dev/urandom of=/mnt/test bs=1M count=96
+ *	ra_pattern_bench -n 100 /mnt/test
+ *
+ * Patterns hold at most 128 ranges, so touching many more pages than that
+ * records only part of them.
+ *
+ * Build with:	gcc -O2 -o ra_pattern_bench ra_pattern_bench.c
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+#ifndef POSIX_FADV_RA_RECORD
+#define POSIX_FADV_RA_RECORD	8
+#define POSIX_FADV_RA_REPLAY	9
+#endif
+
+static long page_size;
+static long *pages;
+static int nr_pages = 100;
+
+static double now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static long majflt(void)
+{
+	struct rusage ru;
+
+	getrusage(RUSAGE_SELF, &ru);
+	return ru.ru_majflt;
+}
+
+static void drop_caches(const char *path)
+{
+	int fd;
+
+	sync();
+	fd = open(path, O_RDONLY);
+	if (fd >= 0) {
+		posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+		close(fd);
+	}
+	fd = open("/proc/sys/vm/drop_caches", O_WRONLY);
+	if (fd < 0 || write(fd, "3\n", 2) != 2)
+		fprintf(stderr, "drop_caches: %s, results may be off\n",
+			strerror(errno));
+	if (fd >= 0)
+		close(fd);
+}
+
+static void pass(const char *name, const char *path, int advice)
+{
+	volatile unsigned char sum = 0;
+	unsigned char *map;
+	struct stat st;
+	double start;
+	long flt;
+	int fd, i;
+
+	drop_caches(path);
+
+	start = now_ms();
+	flt = majflt();
+	fd = open(path, O_RDONLY);
+	if (fd < 0 || fstat(fd, &st)) {
+		perror(path);
+		exit(1);
+	}
+	if (advice >= 0 && posix_fadvise(fd, 0, 0, advice)) {
+		fprintf(stderr, "fadvise %d not supported\n", advice);
+		exit(1);
+	}
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED) {
+		perror("mmap");
+		exit(1);
+	}
+	for (i = 0; i < nr_pages; i++)
+		sum += map[pages[i] * page_size];
+	munmap(map, st.st_size);
+	close(fd);
+
+	printf("%-8s %10.2f ms %8ld major faults\n", name, now_ms() - start,
+	       majflt() - flt);
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "usage: %s [-n pages] [-s seed] file\n", prog);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int seed = 1;
+	struct stat st;
+	long size;
+	int i, opt;
+
+	while ((opt = getopt(argc, argv, "n:s:")) != -1) {
+		switch (opt) {
+		case 'n':
+			nr_pages = atoi(optarg);
+			break;
+		case 's':
+			seed = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind != argc - 1 || nr_pages <= 0)
+		usage(argv[0]);
+
+	page_size = sysconf(_SC_PAGESIZE);
+	if (stat(argv[optind], &st)) {
+		perror(argv[optind]);
+		return 1;
+	}
+	size = st.st_size / page_size;
+	if (!size) {
+		fprintf(stderr, "%s is smaller than a page\n", argv[optind]);
+		return 1;
+	}
+
+	pages = calloc(nr_pages, sizeof(*pages));
+	srandom(seed);
+	for (i = 0; i < nr_pages; i++)
+		pages[i] = random() % size;
+
+	pass("cold", argv[optind], -1);
+	pass("record", argv[optind], POSIX_FADV_RA_RECORD);
+	pass("open", argv[optind], -1);
+	pass("fadvise", argv[optind], POSIX_FADV_RA_REPLAY);
+	return 0;
+}
@@ -0,0 +1,155 @@
+/*
+ * swap_bench.c: measure swap-out and swap-in throughput, e.g. on zram.
+ *
+ * Allocates an anonymous buffer, fills it with half random and half
+ * repetitive data (so that zram compresses it about as well as app memory)
+ * and then writes to every page of it for a number of passes. Once the
+ * buffer does not fit in memory, every pass swaps it out and in again.
+ * Each pass prints its throughput and the swap counters from /proc/vmstat,
+ * including how many pages went out in batched and in single page bios.
+ *
+ * To swap without starving the rest of the system, run it in a memory
+ * cgroup smaller than the buffer:
+ *
+ *	mount -t cgroup -o memory none /dev/memcg
+ *	mkdir /dev/memcg/bench
+ *	swap_bench -m 256 -c /dev/memcg/bench -l 128
+ *
+ * Build with:	gcc -O2 -o swap_bench swap_bench.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/mman.h>
+
+static const char *counters[] = {
+	"pswpin", "pswpout", "pswpout_batched", "pswpout_single",
+	"swap_slots_refill",
+};
+#define NR_COUNTERS	(sizeof(counters) / sizeof(counters[0]))
+
+static void read_vmstat(unsigned long long *val)
+{
+	char name[64];
+	unsigned long long v;
+	unsigned int i;
+	FILE *f;
+
+	memset(val, 0, NR_COUNTERS * sizeof(*val));
+	f = fopen("/proc/vmstat", "r");
+	if (!f) {
+		perror("/proc/vmstat");
+		exit(1);
+	}
+	while (fscanf(f, "%63s %llu", name, &v) == 2)
+		for (i = 0; i < NR_COUNTERS; i++)
+			if (!strcmp(name, counters[i]))
+				val[i] = v;
+	fclose(f);
+}
+
+static void write_file(const char *dir, const char *file, long long val)
+{
+	char path[256], buf[32];
+	int fd, len;
+
+	snprintf(path, sizeof(path), "%s/%s", dir, file);
+	fd = open(path, O_WRONLY);
+	len = snprintf(buf, sizeof(buf), "%lld\n", val);
+	if (fd < 0 || write(fd, buf, len) != len) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		exit(1);
+	}
+	close(fd);
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr, "usage: %s [-m buffer_mb] [-p passes] "
+		"[-c memory_cgroup] [-l cgroup_limit_mb]\n", prog);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long long before[NR_COUNTERS], after[NR_COUNTERS];
+	long size_mb = 256, limit_mb = 0, page_size, i;
+	const char *group = NULL;
+	int passes = 3, pass, opt;
+	unsigned char *buf;
+	size_t size;
+	unsigned int c;
+	double start, t;
+
+	while ((opt = getopt(argc, argv, "m:p:c:l:")) != -1) {
+		switch (opt) {
+		case 'm':
+			size_mb = atol(optarg);
+			break;
+		case 'p':
+			passes = atoi(optarg);
+			break;
+		case 'c':
+			group = optarg;
+			break;
+		case 'l':
+			limit_mb = atol(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (size_mb <= 0 || passes <= 0 || (limit_mb && !group))
+		usage(argv[0]);
+
+	if (group) {
+		if (limit_mb)
+			write_file(group, "memory.limit_in_bytes",
+				   limit_mb << 20);
+		write_file(group, "tasks", getpid());
+	}
+
+	page_size = sysconf(_SC_PAGESIZE);
+	size = (size_t)size_mb << 20;
+	buf = mmap(NULL, size, PROT_READ | PROT_WRITE,
+		   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buf == MAP_FAILED) {
+		perror("mmap");
+		return 1;
+	}
+
+	/* Half of each page random, half of it zero */
+	for (i = 0; i < size; i += sizeof(int))
+		if ((i % page_size) < page_size / 2)
+			*(int *)(buf + i) = rand();
+
+	printf("%4s %10s %10s %10s %10s %10s %10s\n", "pass", "MB/s",
+	       "pswpin", "pswpout", "batched", "single", "refills");
+	for (pass = 1; pass <= passes; pass++) {
+		read_vmstat(before);
+		start = now();
+		for (i = 0; i < size; i += page_size)
+			buf[i]++;
+		t = now() - start;
+		read_vmstat(after);
+
+		printf("%4d %10.1f", pass, size_mb / t);
+		for (c = 0; c < NR_COUNTERS; c++)
+			printf(" %10llu", after[c] - before[c]);
+		printf("\n");
+	}
+	return 0;
+}
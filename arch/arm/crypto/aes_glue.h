@@ -0,0 +1,10 @@
+#ifndef _ARM_CRYPTO_AES_GLUE_H
+#define _ARM_CRYPTO_AES_GLUE_H
+
+/* The scalar core in aes-armv4.S, also used by aesbs-glue.c */
+asmlinkage void __aes_arm_encrypt(const u32 *rk, int rounds, const u8 *in,
+				  u8 *out);
+asmlinkage void __aes_arm_decrypt(const u32 *rk, int rounds, const u8 *in,
+				  u8 *out);
+
+#endif
@@ -0,0 +1,543 @@
+/*
+ * Glue Code for the bit sliced NEON version of the AES Cipher Algorithm
+ *
+ * The core in aesbs-core.S encrypts or decrypts eight blocks at a time,
+ * which suits the modes whose blocks are independent: ECB, CBC decryption,
+ * CTR and XTS. Runs of fewer than eight blocks, CBC encryption and calls
+ * from interrupt context, where kernel mode NEON cannot be used, go to the
+ * scalar code in aes-armv4.S. Both use the key schedule from
+ * crypto/aes_generic.c, which is converted to bit planes at setkey time.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/module.h>
+#include <linux/crypto.h>
+#include <linux/hardirq.h>
+#include <crypto/aes.h>
+#include <crypto/algapi.h>
+#include <crypto/b128ops.h>
+#include <crypto/gf128mul.h>
+#include <asm/neon.h>
+
+#include "aes_glue.h"
+
+#define AESBS_BLOCKS		8
+#define AESBS_BYTES		(AESBS_BLOCKS * AES_BLOCK_SIZE)
+#define AESBS_MAX_ROUNDS	(AES_MAX_KEY_SIZE / 4 + 6)
+
+/*
+ * The first and the last round key as plain bytes, the ones in between as
+ * eight bit planes of 16 bytes each, in the order aesbs-core.S reads them.
+ */
+struct aesbs_key {
+	u8	rk[AES_BLOCK_SIZE * (2 + 8 * (AESBS_MAX_ROUNDS - 1))];
+};
+
+struct aesbs_ctx {
+	struct crypto_aes_ctx	aes;	/* for the scalar code, must be first */
+	struct aesbs_key	enc;
+	struct aesbs_key	dec;
+};
+
+struct aesbs_xts_ctx {
+	struct aesbs_ctx	data;
+	struct crypto_aes_ctx	tweak;
+};
+
+asmlinkage void aesbs_encrypt8(u8 *out, const u8 *in,
+			       const struct aesbs_key *key, int rounds);
+asmlinkage void aesbs_decrypt8(u8 *out, const u8 *in,
+			       const struct aesbs_key *key, int rounds);
+
+static inline int aesbs_rounds(const struct crypto_aes_ctx *aes)
+{
+	return aes->key_length / 4 + 6;
+}
+
+/* Eight blocks or more, and a context in which NEON may be used */
+static inline bool aesbs_use_neon(unsigned int nbytes)
+{
+	return nbytes >= AESBS_BYTES && !in_interrupt();
+}
+
+/* Byte n of round key r, from the little endian words of the schedule */
+static inline u8 rk_byte(const u32 *rk, int r, int n)
+{
+	return rk[4 * r + n / 4] >> (8 * (n % 4));
+}
+
+/*
+ * The core keeps the state in rows: byte p of a plane belongs to byte
+ * 4 * (p % 4) + p / 4 of the block, and plane j holds bit 7 - j of every
+ * byte. Its S-box circuits leave out the 0x63 of the affine map, which
+ * goes into the round keys instead: into the encryption keys that follow
+ * an S-box and the decryption keys that precede one. (Inv)MixColumns maps
+ * a column of 0x63 onto itself, so it makes no difference which side of
+ * it the constant is added.
+ */
+static void aesbs_convert_key(struct aesbs_key *key, const u32 *rk,
+			      int rounds, bool enc)
+{
+	u8 *p = key->rk;
+	int r, j, n;
+	u8 b;
+
+	for (n = 0; n < AES_BLOCK_SIZE; n++)
+		*p++ = rk_byte(rk, 0, n) ^ (enc ? 0 : 0x63);
+
+	for (r = 1; r < rounds; r++)
+		for (j = 0; j < 8; j++)
+			for (n = 0; n < AES_BLOCK_SIZE; n++) {
+				b = rk_byte(rk, r, 4 * (n % 4) + n / 4) ^ 0x63;
+				*p++ = (b >> (7 - j)) & 1 ? 0xff : 0;
+			}
+
+	for (n = 0; n < AES_BLOCK_SIZE; n++)
+		*p++ = rk_byte(rk, rounds, n) ^ (enc ? 0x63 : 0);
+}
+
+static int aesbs_expand_key(struct aesbs_ctx *ctx, const u8 *in_key,
+			    unsigned int key_len, u32 *flags)
+{
+	int rounds;
+
+	if (crypto_aes_expand_key(&ctx->aes, in_key, key_len)) {
+		*flags |= CRYPTO_TFM_RES_BAD_KEY_LEN;
+		return -EINVAL;
+	}
+	rounds = aesbs_rounds(&ctx->aes);
+	aesbs_convert_key(&ctx->enc, ctx->aes.key_enc, rounds, true);
+	aesbs_convert_key(&ctx->dec, ctx->aes.key_dec, rounds, false);
+	return 0;
+}
+
+static int aesbs_set_key(struct crypto_tfm *tfm, const u8 *in_key,
+			 unsigned int key_len)
+{
+	struct aesbs_ctx *ctx = crypto_tfm_ctx(tfm);
+
+	return aesbs_expand_key(ctx, in_key, key_len, &tfm->crt_flags);
+}
+
+static int aesbs_xts_set_key(struct crypto_tfm *tfm, const u8 *in_key,
+			     unsigned int key_len)
+{
+	struct aesbs_xts_ctx *ctx = crypto_tfm_ctx(tfm);
+	u32 *flags = &tfm->crt_flags;
+
+	/* The data key, then the tweak key, of the same size */
+	if (key_len % 2 || crypto_aes_expand_key(&ctx->tweak,
+						 in_key + key_len / 2,
+						 key_len / 2)) {
+		*flags |= CRYPTO_TFM_RES_BAD_KEY_LEN;
+		return -EINVAL;
+	}
+	return aesbs_expand_key(&ctx->data, in_key, key_len / 2, flags);
+}
+
+/* out = in ^ ks, where out and in are either the same or disjoint */
+static inline void aesbs_xor(u8 *out, const u8 *in, const u8 *ks,
+			     unsigned int len)
+{
+	if (out != in)
+		memcpy(out, in, len);
+	crypto_xor(out, ks, len);
+}
+
+static int aesbs_ecb_crypt(struct blkcipher_desc *desc,
+			   struct scatterlist *dst, struct scatterlist *src,
+			   unsigned int nbytes, bool enc)
+{
+	struct aesbs_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+	int rounds = aesbs_rounds(&ctx->aes);
+	struct blkcipher_walk walk;
+	int err;
+
+	blkcipher_walk_init(&walk, dst, src, nbytes);
+	err = blkcipher_walk_virt(desc, &walk);
+
+	while ((nbytes = walk.nbytes)) {
+		u8 *out = walk.dst.virt.addr;
+		u8 *in = walk.src.virt.addr;
+
+		if (aesbs_use_neon(nbytes)) {
+			kernel_neon_begin();
+			do {
+				if (enc)
+					aesbs_encrypt8(out, in, &ctx->enc, rounds);
+				else
+					aesbs_decrypt8(out, in, &ctx->dec, rounds);
+				out += AESBS_BYTES;
+				in += AESBS_BYTES;
+				nbytes -= AESBS_BYTES;
+			} while (nbytes >= AESBS_BYTES);
+			kernel_neon_end();
+		}
+
+		for (; nbytes >= AES_BLOCK_SIZE; nbytes -= AES_BLOCK_SIZE) {
+			if (enc)
+				__aes_arm_encrypt(ctx->aes.key_enc, rounds, in, out);
+			else
+				__aes_arm_decrypt(ctx->aes.key_dec, rounds, in, out);
+			out += AES_BLOCK_SIZE;
+			in += AES_BLOCK_SIZE;
+		}
+		err = blkcipher_walk_done(desc, &walk, nbytes);
+	}
+	return err;
+}
+
+static int aesbs_ecb_encrypt(struct blkcipher_desc *desc,
+			     struct scatterlist *dst, struct scatterlist *src,
+			     unsigned int nbytes)
+{
+	return aesbs_ecb_crypt(desc, dst, src, nbytes, true);
+}
+
+static int aesbs_ecb_decrypt(struct blkcipher_desc *desc,
+			     struct scatterlist *dst, struct scatterlist *src,
+			     unsigned int nbytes)
+{
+	return aesbs_ecb_crypt(desc, dst, src, nbytes, false);
+}
+
+/* Each block depends on the previous one: always the scalar code */
+static int aesbs_cbc_encrypt(struct blkcipher_desc *desc,
+			     struct scatterlist *dst, struct scatterlist *src,
+			     unsigned int nbytes)
+{
+	struct aesbs_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+	int rounds = aesbs_rounds(&ctx->aes);
+	struct blkcipher_walk walk;
+	int err;
+
+	blkcipher_walk_init(&walk, dst, src, nbytes);
+	err = blkcipher_walk_virt(desc, &walk);
+
+	while ((nbytes = walk.nbytes)) {
+		u8 *out = walk.dst.virt.addr;
+		u8 *in = walk.src.virt.addr;
+		u8 *iv = walk.iv;
+
+		for (; nbytes >= AES_BLOCK_SIZE; nbytes -= AES_BLOCK_SIZE) {
+			crypto_xor(iv, in, AES_BLOCK_SIZE);
+			__aes_arm_encrypt(ctx->aes.key_enc, rounds, iv, out);
+			memcpy(iv, out, AES_BLOCK_SIZE);
+			out += AES_BLOCK_SIZE;
+			in += AES_BLOCK_SIZE;
+		}
+		err = blkcipher_walk_done(desc, &walk, nbytes);
+	}
+	return err;
+}
+
+static int aesbs_cbc_decrypt(struct blkcipher_desc *desc,
+			     struct scatterlist *dst, struct scatterlist *src,
+			     unsigned int nbytes)
+{
+	struct aesbs_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+	int rounds = aesbs_rounds(&ctx->aes);
+	struct blkcipher_walk walk;
+	u8 buf[AESBS_BYTES] __aligned(8);
+	int err;
+
+	blkcipher_walk_init(&walk, dst, src, nbytes);
+	err = blkcipher_walk_virt(desc, &walk);
+
+	while ((nbytes = walk.nbytes)) {
+		u8 *out = walk.dst.virt.addr;
+		u8 *in = walk.src.virt.addr;
+		u8 *iv = walk.iv;
+
+		/*
+		 * Decrypt into buf, so that the ciphertext is still there
+		 * to be xored in when the request is done in place.
+		 */
+		if (aesbs_use_neon(nbytes)) {
+			kernel_neon_begin();
+			do {
+				aesbs_decrypt8(buf, in, &ctx->dec, rounds);
+				crypto_xor(buf, iv, AES_BLOCK_SIZE);
+				crypto_xor(buf + AES_BLOCK_SIZE, in,
+					   AESBS_BYTES - AES_BLOCK_SIZE);
+				memcpy(iv, in + AESBS_BYTES - AES_BLOCK_SIZE,
+				       AES_BLOCK_SIZE);
+				memcpy(out, buf, AESBS_BYTES);
+				out += AESBS_BYTES;
+				in += AESBS_BYTES;
+				nbytes -= AESBS_BYTES;
+			} while (nbytes >= AESBS_BYTES);
+			kernel_neon_end();
+		}
+
+		for (; nbytes >= AES_BLOCK_SIZE; nbytes -= AES_BLOCK_SIZE) {
+			__aes_arm_decrypt(ctx->aes.key_dec, rounds, in, buf);
+			crypto_xor(buf, iv, AES_BLOCK_SIZE);
+			memcpy(iv, in, AES_BLOCK_SIZE);
+			memcpy(out, buf, AES_BLOCK_SIZE);
+			out += AES_BLOCK_SIZE;
+			in += AES_BLOCK_SIZE;
+		}
+		err = blkcipher_walk_done(desc, &walk, nbytes);
+	}
+	return err;
+}
+
+static int aesbs_ctr_crypt(struct blkcipher_desc *desc,
+			   struct scatterlist *dst, struct scatterlist *src,
+			   unsigned int nbytes)
+{
+	struct aesbs_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+	int rounds = aesbs_rounds(&ctx->aes);
+	struct blkcipher_walk walk;
+	u8 ks[AESBS_BYTES] __aligned(8);
+	int err, i;
+
+	blkcipher_walk_init(&walk, dst, src, nbytes);
+	err = blkcipher_walk_virt_block(desc, &walk, AES_BLOCK_SIZE);
+
+	while ((nbytes = walk.nbytes) >= AES_BLOCK_SIZE) {
+		u8 *out = walk.dst.virt.addr;
+		u8 *in = walk.src.virt.addr;
+
+		if (aesbs_use_neon(nbytes)) {
+			kernel_neon_begin();
+			do {
+				for (i = 0; i < AESBS_BLOCKS; i++) {
+					memcpy(ks + i * AES_BLOCK_SIZE, walk.iv,
+					       AES_BLOCK_SIZE);
+					crypto_inc(walk.iv, AES_BLOCK_SIZE);
+				}
+				aesbs_encrypt8(ks, ks, &ctx->enc, rounds);
+				aesbs_xor(out, in, ks, AESBS_BYTES);
+				out += AESBS_BYTES;
+				in += AESBS_BYTES;
+				nbytes -= AESBS_BYTES;
+			} while (nbytes >= AESBS_BYTES);
+			kernel_neon_end();
+		}
+
+		for (; nbytes >= AES_BLOCK_SIZE; nbytes -= AES_BLOCK_SIZE) {
+			__aes_arm_encrypt(ctx->aes.key_enc, rounds, walk.iv, ks);
+			crypto_inc(walk.iv, AES_BLOCK_SIZE);
+			aesbs_xor(out, in, ks, AES_BLOCK_SIZE);
+			out += AES_BLOCK_SIZE;
+			in += AES_BLOCK_SIZE;
+		}
+		err = blkcipher_walk_done(desc, &walk, nbytes);
+	}
+
+	/* A partial last block takes the start of one more key stream block */
+	if (walk.nbytes) {
+		__aes_arm_encrypt(ctx->aes.key_enc, rounds, walk.iv, ks);
+		crypto_inc(walk.iv, AES_BLOCK_SIZE);
+		aesbs_xor(walk.dst.virt.addr, walk.src.virt.addr, ks,
+			  walk.nbytes);
+		err = blkcipher_walk_done(desc, &walk, 0);
+	}
+	return err;
+}
+
+static int aesbs_xts_crypt(struct blkcipher_desc *desc,
+			   struct scatterlist *dst, struct scatterlist *src,
+			   unsigned int nbytes, bool enc)
+{
+	struct aesbs_xts_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+	int rounds = aesbs_rounds(&ctx->data.aes);
+	struct blkcipher_walk walk;
+	be128 tw[AESBS_BLOCKS];
+	u8 buf[AESBS_BYTES] __aligned(8);
+	be128 *t;
+	int err, i;
+
+	blkcipher_walk_init(&walk, dst, src, nbytes);
+	err = blkcipher_walk_virt(desc, &walk);
+
+	/* The first tweak is the IV encrypted with the tweak key */
+	t = (be128 *)walk.iv;
+	__aes_arm_encrypt(ctx->tweak.key_enc, aesbs_rounds(&ctx->tweak),
+			  walk.iv, walk.iv);
+
+	while ((nbytes = walk.nbytes)) {
+		u8 *out = walk.dst.virt.addr;
+		u8 *in = walk.src.virt.addr;
+
+		if (aesbs_use_neon(nbytes)) {
+			kernel_neon_begin();
+			do {
+				for (i = 0; i < AESBS_BLOCKS; i++) {
+					tw[i] = *t;
+					gf128mul_x_ble(t, t);
+				}
+				aesbs_xor(buf, in, (u8 *)tw, AESBS_BYTES);
+				if (enc)
+					aesbs_encrypt8(buf, buf, &ctx->data.enc,
+						       rounds);
+				else
+					aesbs_decrypt8(buf, buf, &ctx->data.dec,
+						       rounds);
+				aesbs_xor(out, buf, (u8 *)tw, AESBS_BYTES);
+				out += AESBS_BYTES;
+				in += AESBS_BYTES;
+				nbytes -= AESBS_BYTES;
+			} while (nbytes >= AESBS_BYTES);
+			kernel_neon_end();
+		}
+
+		for (; nbytes >= AES_BLOCK_SIZE; nbytes -= AES_BLOCK_SIZE) {
+			aesbs_xor(buf, in, (u8 *)t, AES_BLOCK_SIZE);
+			if (enc)
+				__aes_arm_encrypt(ctx->data.aes.key_enc, rounds,
+						  buf, buf);
+			else
+				__aes_arm_decrypt(ctx->data.aes.key_dec, rounds,
+						  buf, buf);
+			aesbs_xor(out, buf, (u8 *)t, AES_BLOCK_SIZE);
+			gf128mul_x_ble(t, t);
+			out += AES_BLOCK_SIZE;
+			in += AES_BLOCK_SIZE;
+		}
+		err = blkcipher_walk_done(desc, &walk, nbytes);
+	}
+	return err;
+}
+
+static int aesbs_xts_encrypt(struct blkcipher_desc *desc,
+			     struct scatterlist *dst, struct scatterlist *src,
+			     unsigned int nbytes)
+{
+	return aesbs_xts_crypt(desc, dst, src, nbytes, true);
+}
+
+static int aesbs_xts_decrypt(struct blkcipher_desc *desc,
+			     struct scatterlist *dst, struct scatterlist *src,
+			     unsigned int nbytes)
+{
+	return aesbs_xts_crypt(desc, dst, src, nbytes, false);
+}
+
+/* Above aes-asm, and so above the templates instantiated over it */
+#define AESBS_PRIORITY		250
+
+static struct crypto_alg aesbs_algs[] = { {
+	.cra_name		= "ecb(aes)",
+	.cra_driver_name	= "ecb-aes-neonbs",
+	.cra_priority		= AESBS_PRIORITY,
+	.cra_flags		= CRYPTO_ALG_TYPE_BLKCIPHER,
+	.cra_blocksize		= AES_BLOCK_SIZE,
+	.cra_ctxsize		= sizeof(struct aesbs_ctx),
+	.cra_alignmask		= 0,
+	.cra_type		= &crypto_blkcipher_type,
+	.cra_module		= THIS_MODULE,
+	.cra_u = {
+		.blkcipher = {
+			.min_keysize	= AES_MIN_KEY_SIZE,
+			.max_keysize	= AES_MAX_KEY_SIZE,
+			.setkey		= aesbs_set_key,
+			.encrypt	= aesbs_ecb_encrypt,
+			.decrypt	= aesbs_ecb_decrypt,
+		},
+	},
+}, {
+	.cra_name		= "cbc(aes)",
+	.cra_driver_name	= "cbc-aes-neonbs",
+	.cra_priority		= AESBS_PRIORITY,
+	.cra_flags		= CRYPTO_ALG_TYPE_BLKCIPHER,
+	.cra_blocksize		= AES_BLOCK_SIZE,
+	.cra_ctxsize		= sizeof(struct aesbs_ctx),
+	.cra_alignmask		= 3,
+	.cra_type		= &crypto_blkcipher_type,
+	.cra_module		= THIS_MODULE,
+	.cra_u = {
+		.blkcipher = {
+			.min_keysize	= AES_MIN_KEY_SIZE,
+			.max_keysize	= AES_MAX_KEY_SIZE,
+			.ivsize		= AES_BLOCK_SIZE,
+			.setkey		= aesbs_set_key,
+			.encrypt	= aesbs_cbc_encrypt,
+			.decrypt	= aesbs_cbc_decrypt,
+		},
+	},
+}, {
+	.cra_name		= "ctr(aes)",
+	.cra_driver_name	= "ctr-aes-neonbs",
+	.cra_priority		= AESBS_PRIORITY,
+	.cra_flags		= CRYPTO_ALG_TYPE_BLKCIPHER,
+	.cra_blocksize		= 1,
+	.cra_ctxsize		= sizeof(struct aesbs_ctx),
+	.cra_alignmask		= 3,
+	.cra_type		= &crypto_blkcipher_type,
+	.cra_module		= THIS_MODULE,
+	.cra_u = {
+		.blkcipher = {
+			.min_keysize	= AES_MIN_KEY_SIZE,
+			.max_keysize	= AES_MAX_KEY_SIZE,
+			.ivsize		= AES_BLOCK_SIZE,
+			.setkey		= aesbs_set_key,
+			.encrypt	= aesbs_ctr_crypt,
+			.decrypt	= aesbs_ctr_crypt,
+		},
+	},
+}, {
+	.cra_name		= "xts(aes)",
+	.cra_driver_name	= "xts-aes-neonbs",
+	.cra_priority		= AESBS_PRIORITY,
+	.cra_flags		= CRYPTO_ALG_TYPE_BLKCIPHER,
+	.cra_blocksize		= AES_BLOCK_SIZE,
+	.cra_ctxsize		= sizeof(struct aesbs_xts_ctx),
+	.cra_alignmask		= 3,
+	.cra_type		= &crypto_blkcipher_type,
+	.cra_module		= THIS_MODULE,
+	.cra_u = {
+		.blkcipher = {
+			.min_keysize	= 2 * AES_MIN_KEY_SIZE,
+			.max_keysize	= 2 * AES_MAX_KEY_SIZE,
+			.ivsize		= AES_BLOCK_SIZE,
+			.setkey		= aesbs_xts_set_key,
+			.encrypt	= aesbs_xts_encrypt,
+			.decrypt	= aesbs_xts_decrypt,
+		},
+	},
+} };
+
+static int __init aesbs_init(void)
+{
+	int i, err;
+
+	if (!cpu_has_neon())
+		return -ENODEV;
+
+	for (i = 0; i < ARRAY_SIZE(aesbs_algs); i++) {
+		INIT_LIST_HEAD(&aesbs_algs[i].cra_list);
+		err = crypto_register_alg(&aesbs_algs[i]);
+		if (err)
+			goto unregister;
+	}
+	return 0;
+
+unregister:
+	while (--i >= 0)
+		crypto_unregister_alg(&aesbs_algs[i]);
+	return err;
+}
+
+static void __exit aesbs_fini(void)
+{
+	int i;
+
+	for (i = ARRAY_SIZE(aesbs_algs) - 1; i >= 0; i--)
+		crypto_unregister_alg(&aesbs_algs[i]);
+}
+
+module_init(aesbs_init);
+module_exit(aesbs_fini);
+
+MODULE_DESCRIPTION("Bit sliced AES in ECB, CBC, CTR and XTS modes, NEON optimized");
+MODULE_LICENSE("GPL");
+MODULE_ALIAS("ecb(aes)");
+MODULE_ALIAS("cbc(aes)");
+MODULE_ALIAS("ctr(aes)");
+MODULE_ALIAS("xts(aes)");
@@ -1,4 +1,7 @@
 #ifndef __ASMARM_AUXVEC_H
 #define __ASMARM_AUXVEC_H
 
+/* Entry for the vDSO ELF header */
+#define AT_SYSINFO_EHDR	33
+
 #endif
@@ -30,6 +30,7 @@ struct map_desc {
 #define MT_MEMORY_DTCM		12
 #define MT_MEMORY_ITCM		13
 #define MT_MEMORY_SO		14
+#define MT_DEVICE_USER		15
 
 #ifdef CONFIG_MMU
 extern void iotable_init(struct map_desc *, int);
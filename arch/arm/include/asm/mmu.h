@@ -5,18 +5,16 @@
 
 typedef struct {
 #ifdef CONFIG_CPU_HAS_ASID
-	unsigned int id;
-	spinlock_t id_lock;
+	atomic64_t id;
 #endif
 	unsigned int kvm_seq;
+#ifdef CONFIG_VDSO
+	unsigned long vdso;
+#endif
 } mm_context_t;
 
 #ifdef CONFIG_CPU_HAS_ASID
-#define ASID(mm)	((mm)->context.id & 255)
-
-/* init_mm.context.id_lock should be initialized. */
-#define INIT_MM_CONTEXT(name)                                                 \
-	.context.id_lock    = __SPIN_LOCK_UNLOCKED(name.context.id_lock),
+#define ASID(mm)	((unsigned int)((mm)->context.id.counter & 255))
 #else
 #define ASID(mm)	(0)
 #endif
@@ -0,0 +1,45 @@
+/*
+ * arch/arm/include/asm/neon.h
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef __ASM_ARM_NEON_H
+#define __ASM_ARM_NEON_H
+
+#include <linux/types.h>
+#include <asm/hwcap.h>
+
+#define cpu_has_neon()		(!!(elf_hwcap & HWCAP_NEON))
+
+/*
+ * Kernel mode NEON may only be used outside of interrupt context.
+ * kernel_neon_begin() saves the VFP/NEON state of its owner and disables
+ * preemption until the matching kernel_neon_end(). Calls may nest.
+ *
+ * Keep the NEON code itself in assembler or in a separate compilation
+ * unit, so that the compiler cannot move NEON instructions outside of
+ * the begin/end pair.
+ */
+extern void kernel_neon_begin(void);
+extern void kernel_neon_end(void);
+
+#ifdef CONFIG_NEON_STRING_OPS
+/* Size from which memcpy, memset and copy_page use NEON, see string_neon.c */
+extern unsigned long neon_copy_threshold;
+
+/* Integer routines, entered past the threshold check */
+extern void *__memcpy_arm(void *dest, const void *src, size_t n);
+extern void __memset_arm(void *dest, int c, size_t n);
+extern void __memzero_arm(void *dest, size_t n);
+extern void __copy_page_arm(void *to, const void *from);
+
+/* NEON routines, falling back to the integer ones in interrupt context */
+extern void *memcpy_neon(void *dest, const void *src, size_t n);
+extern void *memset_neon(void *dest, int c, size_t n);
+extern void memzero_neon(void *dest, size_t n);
+extern void copy_page_neon(void *to, const void *from);
+#endif
+
+#endif /* __ASM_ARM_NEON_H */
@@ -154,6 +154,13 @@ extern void __pgd_error(const char *file, int line, pgd_t);
 #define SUPERSECTION_SIZE	(1UL << SUPERSECTION_SHIFT)
 #define SUPERSECTION_MASK	(~(SUPERSECTION_SIZE-1))
 
+/*
+ * ARMv6 large page address mask and size definitions.
+ */
+#define LARGE_PAGE_SHIFT	16
+#define LARGE_PAGE_SIZE		(1UL << LARGE_PAGE_SHIFT)
+#define LARGE_PAGE_MASK		(~(LARGE_PAGE_SIZE-1))
+
 /*
  * "Linux" PTE definitions.
  *
@@ -475,6 +482,20 @@ static inline pte_t pte_modify(pte_t pte, pgprot_t newprot)
 #define io_remap_pfn_range(vma,from,pfn,size,prot) \
 		remap_pfn_range(vma, from, pfn, size, prot)
 
+/*
+ * remap_pfn_range() using large pages where the range allows it, the
+ * matching vm_ops->open hook for when such a mapping is split, and the
+ * hook for mprotect() and mremap().
+ */
+#define __HAVE_ARCH_REMAP_PFN_RANGE_LARGE
+struct vm_area_struct;
+extern int remap_pfn_range_large(struct vm_area_struct *vma,
+				 unsigned long addr, unsigned long pfn,
+				 unsigned long size, pgprot_t prot);
+extern void split_large_pages(struct vm_area_struct *vma);
+extern void split_large_pages_range(struct vm_area_struct *vma,
+				    unsigned long start, unsigned long end);
+
 #define pgtable_cache_init() do { } while (0)
 
 void identity_mapping_add(pgd_t *, unsigned long, unsigned long);
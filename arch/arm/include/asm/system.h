@@ -537,6 +537,10 @@ static inline unsigned long long __cmpxchg64_mb(volatile void *ptr,
 
 #define arch_align_stack(x) (x)
 
+#ifdef CONFIG_VDSO
+#define AT_VECTOR_SIZE_ARCH 1	/* entries in ARCH_DLINFO */
+#endif
+
 #endif /* __KERNEL__ */
 
 #endif
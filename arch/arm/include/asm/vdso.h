@@ -0,0 +1,36 @@
+#ifndef __ASM_ARM_VDSO_H
+#define __ASM_ARM_VDSO_H
+
+#ifdef __KERNEL__
+
+/*
+ * Platforms whose clocksource counter may be read from user space map
+ * its page here, next to the vectors page, as MT_DEVICE_USER.
+ */
+#define VDSO_COUNTER_PAGE	0xffff1000
+
+#ifndef __ASSEMBLY__
+
+struct clocksource;
+
+#ifdef CONFIG_VDSO
+extern int vdso_user_mapping(void);
+extern void vdso_register_clocksource(struct clocksource *cs,
+				      unsigned long counter, u32 bias);
+#else
+static inline int vdso_user_mapping(void)
+{
+	return 0;
+}
+
+static inline void vdso_register_clocksource(struct clocksource *cs,
+					     unsigned long counter, u32 bias)
+{
+}
+#endif
+
+#endif /* __ASSEMBLY__ */
+
+#endif /* __KERNEL__ */
+
+#endif /* __ASM_ARM_VDSO_H */
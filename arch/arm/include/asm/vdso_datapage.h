@@ -0,0 +1,38 @@
+#ifndef __ASM_ARM_VDSO_DATAPAGE_H
+#define __ASM_ARM_VDSO_DATAPAGE_H
+
+#ifdef __KERNEL__
+
+#ifndef __ASSEMBLY__
+
+#include <linux/types.h>
+
+/*
+ * Timekeeping data shared with user space, updated by update_vsyscall().
+ * Readers retry while seq_count is odd or has changed.
+ *
+ * The counter is read at cs_counter, cs_cycle_last is in the same raw
+ * units: the time elapsed since the update is
+ * ((*cs_counter - cs_cycle_last) & cs_mask) * cs_mult >> cs_shift.
+ */
+struct vdso_data {
+	u32 seq_count;		/* odd while an update is in progress */
+	u32 use_syscall;	/* the counter cannot be read from user space */
+	u32 cs_counter;		/* user address of the 32-bit counter */
+	u32 cs_cycle_last;	/* raw counter value at the last update */
+	u32 cs_mask;
+	u32 cs_mult;
+	u32 cs_shift;
+	u32 xtime_sec;		/* CLOCK_REALTIME at the last update */
+	u32 xtime_nsec;
+	u32 wtm_sec;		/* wall_to_monotonic */
+	u32 wtm_nsec;
+	u32 tz_minuteswest;	/* gettimeofday() timezone */
+	u32 tz_dsttime;
+};
+
+#endif /* __ASSEMBLY__ */
+
+#endif /* __KERNEL__ */
+
+#endif /* __ASM_ARM_VDSO_DATAPAGE_H */
@@ -90,7 +90,12 @@ int main(void)
   DEFINE(S_FRAME_SIZE,		sizeof(struct pt_regs));
   BLANK();
 #ifdef CONFIG_CPU_HAS_ASID
-  DEFINE(MM_CONTEXT_ID,		offsetof(struct mm_struct, context.id));
+  /* The low word of the 64-bit context.id, which holds the ASID */
+#ifdef __ARMEB__
+  DEFINE(MM_CONTEXT_ID,		offsetof(struct mm_struct, context.id.counter) + 4);
+#else
+  DEFINE(MM_CONTEXT_ID,		offsetof(struct mm_struct, context.id.counter));
+#endif
   BLANK();
 #endif
   DEFINE(VMA_VM_MM,		offsetof(struct vm_area_struct, vm_mm));
@@ -36,6 +36,9 @@
 #include <linux/kallsyms.h>
 #include <linux/proc_fs.h>
 #include <linux/ftrace.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/debugfs.h>
 
 #include <asm/system.h>
 #include <asm/mach/arch.h>
@@ -68,6 +71,52 @@ int arch_show_interrupts(struct seq_file *p, int prec)
 	return 0;
 }
 
+#ifdef CONFIG_IRQ_LATENCY_HIST
+/*
+ * Handler durations in microseconds, in log2 buckets: bucket 0 counts
+ * durations under 1us, bucket n those under 2^n us, and the last one
+ * everything longer.  Chained handlers are accounted to their parent.
+ */
+#define IRQ_HIST_BUCKETS	16
+
+struct irq_hist {
+	u32 count[IRQ_HIST_BUCKETS];
+	u32 max_us;
+};
+
+static struct irq_hist *irq_hist[NR_CPUS];
+
+static inline u64 irq_hist_start(void)
+{
+	return sched_clock();
+}
+
+static inline void irq_hist_record(unsigned int irq, u64 start)
+{
+	struct irq_hist *h = irq_hist[smp_processor_id()];
+	u64 ns = sched_clock() - start;
+	u32 us;
+
+	if (!h)
+		return;
+
+	us = ns < UINT_MAX ? (u32)ns / 1000 : UINT_MAX / 1000;
+	h += irq;
+	h->count[min(fls(us), IRQ_HIST_BUCKETS - 1)]++;
+	if (us > h->max_us)
+		h->max_us = us;
+}
+#else
+static inline u64 irq_hist_start(void)
+{
+	return 0;
+}
+
+static inline void irq_hist_record(unsigned int irq, u64 start)
+{
+}
+#endif
+
 /*
  * do_IRQ handles all hardware IRQ's.  Decoded IRQs should not
  * come via this function.  Instead, they should provide their
@@ -89,7 +138,10 @@ asm_do_IRQ(unsigned int irq, struct pt_regs *regs)
 			printk(KERN_WARNING "Bad IRQ%u\n", irq);
 		ack_bad_irq(irq);
 	} else {
+		u64 start = irq_hist_start();
+
 		generic_handle_irq(irq);
+		irq_hist_record(irq, start);
 	}
 
 	/* AT91 specific workaround */
@@ -186,3 +238,108 @@ void migrate_irqs(void)
 	local_irq_restore(flags);
 }
 #endif /* CONFIG_HOTPLUG_CPU */
+
+#ifdef CONFIG_IRQ_LATENCY_HIST
+/* Laid out like /proc/interrupts, with the CPUs summed up */
+static int irq_hist_show(struct seq_file *p, void *v)
+{
+	unsigned long flags;
+	struct irqaction *action;
+	struct irq_desc *desc;
+	int prec, i, j, cpu;
+
+	for (prec = 3, j = 1000; prec < 10 && j <= nr_irqs; ++prec)
+		j *= 10;
+
+	seq_printf(p, "%*s", prec + 2, "");
+	for (j = 0; j < IRQ_HIST_BUCKETS - 1; j++) {
+		char label[12];
+
+		snprintf(label, sizeof(label), "<%uus", 1U << j);
+		seq_printf(p, "%8s ", label);
+	}
+	seq_printf(p, "%8s %8s\n", "longer", "max us");
+
+	for_each_irq_desc(i, desc) {
+		u32 count[IRQ_HIST_BUCKETS] = { 0 }, max_us = 0, any = 0;
+
+		for_each_possible_cpu(cpu) {
+			struct irq_hist *h = irq_hist[cpu];
+
+			if (!h)
+				continue;
+			h += i;
+			for (j = 0; j < IRQ_HIST_BUCKETS; j++) {
+				count[j] += h->count[j];
+				any |= h->count[j];
+			}
+			max_us = max(max_us, h->max_us);
+		}
+		if (!any)
+			continue;
+
+		seq_printf(p, "%*d: ", prec, i);
+		for (j = 0; j < IRQ_HIST_BUCKETS; j++)
+			seq_printf(p, "%8u ", count[j]);
+		seq_printf(p, "%8u", max_us);
+
+		raw_spin_lock_irqsave(&desc->lock, flags);
+		if (desc->irq_data.chip && desc->irq_data.chip->name)
+			seq_printf(p, " %8s", desc->irq_data.chip->name);
+		action = desc->action;
+		if (action) {
+			seq_printf(p, "  %s", action->name);
+			while ((action = action->next) != NULL)
+				seq_printf(p, ", %s", action->name);
+		}
+		raw_spin_unlock_irqrestore(&desc->lock, flags);
+		seq_putc(p, '\n');
+	}
+	return 0;
+}
+
+static int irq_hist_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, irq_hist_show, NULL);
+}
+
+static ssize_t irq_hist_write(struct file *file, const char __user *buf,
+			      size_t count, loff_t *ppos)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		if (irq_hist[cpu])
+			memset(irq_hist[cpu], 0,
+			       nr_irqs * sizeof(struct irq_hist));
+	return count;
+}
+
+static const struct file_operations irq_hist_fops = {
+	.open		= irq_hist_open,
+	.read		= seq_read,
+	.write		= irq_hist_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init irq_hist_init(void)
+{
+	struct dentry *dir;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		irq_hist[cpu] = kcalloc(nr_irqs, sizeof(struct irq_hist),
+					GFP_KERNEL);
+		if (!irq_hist[cpu])
+			return -ENOMEM;
+	}
+
+	dir = debugfs_create_dir("irq_latency", NULL);
+	if (!dir)
+		return -ENOMEM;
+	debugfs_create_file("histogram", 0644, dir, NULL, &irq_hist_fops);
+	return 0;
+}
+late_initcall(irq_hist_init);
+#endif
@@ -38,6 +38,7 @@
 #include <asm/thread_notify.h>
 #include <asm/stacktrace.h>
 #include <asm/mach/time.h>
+#include <asm/vdso.h>
 
 #ifdef CONFIG_CC_STACKPROTECTOR
 #include <linux/stackprotector.h>
@@ -618,8 +619,24 @@ int vectors_user_mapping(void)
 				       NULL);
 }
 
+int arch_setup_additional_pages(struct linux_binprm *bprm, int uses_interp)
+{
+	int ret;
+
+	ret = vectors_user_mapping();
+	if (ret)
+		return ret;
+	return vdso_user_mapping();
+}
+
 const char *arch_vma_name(struct vm_area_struct *vma)
 {
-	return (vma->vm_start == 0xffff0000) ? "[vectors]" : NULL;
+	if (vma->vm_start == 0xffff0000)
+		return "[vectors]";
+#ifdef CONFIG_VDSO
+	if (vma->vm_mm && vma->vm_start == vma->vm_mm->context.vdso)
+		return "[vdso]";
+#endif
+	return NULL;
 }
 #endif
@@ -9,6 +9,7 @@
 #include <linux/init.h>
 #include <linux/jiffies.h>
 #include <linux/kernel.h>
+#include <linux/moduleparam.h>
 #include <linux/sched.h>
 #include <linux/timer.h>
 
@@ -17,6 +18,14 @@
 static void sched_clock_poll(unsigned long wrap_ticks);
 static DEFINE_TIMER(sched_clock_timer, sched_clock_poll, 0, 0);
 static void (*sched_clock_update_fn)(void);
+static unsigned long sched_clock_rate;
+
+/*
+ * IRQ time accounting reads sched_clock() on every hard and soft IRQ
+ * transition. -1 enables it from 1MHz up, 0 and 1 force it off or on.
+ */
+static int irqtime = -1;
+core_param(irqtime, irqtime, int, 0400);
 
 static void sched_clock_poll(unsigned long wrap_ticks)
 {
@@ -32,6 +41,7 @@ void __init init_sched_clock(struct clock_data *cd, void (*update)(void),
 	char r_unit;
 
 	sched_clock_update_fn = update;
+	sched_clock_rate = rate;
 
 	/* calculate the mult/shift to convert counter ticks to ns. */
 	clocks_calc_mult_shift(&cd->mult, &cd->shift, rate, NSEC_PER_SEC, 0);
@@ -71,4 +81,7 @@ void __init init_sched_clock(struct clock_data *cd, void (*update)(void),
 void __init sched_clock_postinit(void)
 {
 	sched_clock_poll(sched_clock_timer.data);
+
+	if (irqtime > 0 || (irqtime == -1 && sched_clock_rate >= 1000000))
+		enable_sched_clock_irqtime();
 }
@@ -0,0 +1,154 @@
+/*
+ *  linux/arch/arm/kernel/vdso.c
+ *
+ *  The vDSO: gettimeofday() and clock_gettime() running in user space,
+ *  from timekeeping data kept in a page shared with every process.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/clocksource.h>
+#include <linux/err.h>
+#include <linux/mm.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/time.h>
+
+#include <asm/system.h>
+#include <asm/vdso.h>
+#include <asm/vdso_datapage.h>
+
+extern char vdso_start[], vdso_end[];
+
+/* The data page is mapped right below the code */
+static union {
+	struct vdso_data data;
+	u8 page[PAGE_SIZE];
+} vdso_data_store __page_aligned_data;
+static struct vdso_data *vdso_data = &vdso_data_store.data;
+
+static struct page *vdso_data_pagelist[2];
+static struct page **vdso_pagelist;
+static unsigned int vdso_pages;
+
+static struct clocksource *vdso_clocksource;
+static unsigned long vdso_counter;
+static u32 vdso_bias;
+
+/*
+ * Let the vDSO read @cs itself: its 32-bit counter can be read from
+ * user space at @counter, and cs->read() returns the counter minus @bias.
+ * The vDSO makes system calls while any other clocksource is in use.
+ */
+void __init vdso_register_clocksource(struct clocksource *cs,
+				      unsigned long counter, u32 bias)
+{
+	if (cs->mask != CLOCKSOURCE_MASK(32))
+		return;
+
+	vdso_counter = counter;
+	vdso_bias = bias;
+	vdso_clocksource = cs;
+}
+
+static int __init vdso_init(void)
+{
+	unsigned int i;
+
+	if (memcmp(vdso_start, "\177ELF", 4)) {
+		printk(KERN_ERR "vDSO is not a valid ELF object!\n");
+		return -EINVAL;
+	}
+
+	vdso_pages = (vdso_end - vdso_start) >> PAGE_SHIFT;
+	vdso_pagelist = kcalloc(vdso_pages + 1, sizeof(struct page *),
+				GFP_KERNEL);
+	if (!vdso_pagelist)
+		return -ENOMEM;
+
+	for (i = 0; i < vdso_pages; i++)
+		vdso_pagelist[i] = virt_to_page(vdso_start + i * PAGE_SIZE);
+	vdso_data_pagelist[0] = virt_to_page(vdso_data);
+	return 0;
+}
+arch_initcall(vdso_init);
+
+/* Called from arch_setup_additional_pages() on exec */
+int vdso_user_mapping(void)
+{
+	struct mm_struct *mm = current->mm;
+	unsigned long addr;
+	int ret;
+
+	mm->context.vdso = 0;
+	if (!vdso_pagelist)
+		return 0;
+
+	down_write(&mm->mmap_sem);
+	addr = get_unmapped_area(NULL, 0, (vdso_pages + 1) << PAGE_SHIFT,
+				 0, 0);
+	if (IS_ERR_VALUE(addr)) {
+		ret = addr;
+		goto out;
+	}
+
+	ret = install_special_mapping(mm, addr, PAGE_SIZE,
+				      VM_READ | VM_MAYREAD,
+				      vdso_data_pagelist);
+	if (ret)
+		goto out;
+
+	/* VM_MAYWRITE is needed for breakpoints set through ptrace */
+	addr += PAGE_SIZE;
+	ret = install_special_mapping(mm, addr, vdso_pages << PAGE_SHIFT,
+				      VM_READ | VM_EXEC |
+				      VM_MAYREAD | VM_MAYWRITE | VM_MAYEXEC |
+				      VM_ALWAYSDUMP,
+				      vdso_pagelist);
+	if (!ret)
+		mm->context.vdso = addr;
+out:
+	up_write(&mm->mmap_sem);
+	return ret;
+}
+
+/* Called from timekeeping with xtime_lock held */
+void update_vsyscall(struct timespec *wall_time, struct timespec *wtm,
+		     struct clocksource *clock, u32 mult)
+{
+	struct vdso_data *vd = vdso_data;
+
+	++vd->seq_count;
+	smp_wmb();
+
+	vd->use_syscall = clock != vdso_clocksource;
+	if (!vd->use_syscall) {
+		vd->cs_counter = vdso_counter;
+		vd->cs_cycle_last = (u32)clock->cycle_last + vdso_bias;
+		vd->cs_mask = clock->mask;
+		vd->cs_mult = mult;
+		vd->cs_shift = clock->shift;
+	}
+	vd->xtime_sec = wall_time->tv_sec;
+	vd->xtime_nsec = wall_time->tv_nsec;
+	vd->wtm_sec = wtm->tv_sec;
+	vd->wtm_nsec = wtm->tv_nsec;
+
+	smp_wmb();
+	++vd->seq_count;
+}
+
+void update_vsyscall_tz(void)
+{
+	struct vdso_data *vd = vdso_data;
+
+	++vd->seq_count;
+	smp_wmb();
+	vd->tz_minuteswest = sys_tz.tz_minuteswest;
+	vd->tz_dsttime = sys_tz.tz_dsttime;
+	smp_wmb();
+	++vd->seq_count;
+}
@@ -0,0 +1,203 @@
+/*
+ *  linux/arch/arm/kernel/vdso/vgettimeofday.c
+ *
+ *  gettimeofday() and clock_gettime() for the vDSO.  This runs in user
+ *  space: no kernel functions, no library calls, no writable data.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#include <linux/compiler.h>
+#include <linux/time.h>
+#include <asm/processor.h>
+#include <asm/system.h>
+#include <asm/unistd.h>
+#include <asm/vdso_datapage.h>
+
+extern struct vdso_data *__get_datapage(void)
+	__attribute__((visibility("hidden")));
+
+static notrace u32 vdso_read_begin(const struct vdso_data *vd)
+{
+	u32 seq;
+
+	while ((seq = ACCESS_ONCE(vd->seq_count)) & 1)
+		cpu_relax();
+	smp_rmb();
+	return seq;
+}
+
+static notrace int vdso_read_retry(const struct vdso_data *vd, u32 start)
+{
+	smp_rmb();
+	return ACCESS_ONCE(vd->seq_count) != start;
+}
+
+static notrace long clock_gettime_fallback(clockid_t clkid,
+					   struct timespec *ts)
+{
+	register clockid_t r0 asm("r0") = clkid;
+	register struct timespec *r1 asm("r1") = ts;
+	register long nr asm("r7") = __NR_clock_gettime;
+	register long ret asm("r0");
+
+	asm volatile("swi #0"
+		     : "=r" (ret)
+		     : "r" (r0), "r" (r1), "r" (nr)
+		     : "memory");
+	return ret;
+}
+
+static notrace long gettimeofday_fallback(struct timeval *tv,
+					  struct timezone *tz)
+{
+	register struct timeval *r0 asm("r0") = tv;
+	register struct timezone *r1 asm("r1") = tz;
+	register long nr asm("r7") = __NR_gettimeofday;
+	register long ret asm("r0");
+
+	asm volatile("swi #0"
+		     : "=r" (ret)
+		     : "r" (r0), "r" (r1), "r" (nr)
+		     : "memory");
+	return ret;
+}
+
+/* A 64-bit right shift that does not end up in libgcc */
+static notrace u64 vdso_shr(u64 v, u32 shift)
+{
+	u32 lo = v, hi = v >> 32;
+
+	if (shift >= 32)
+		return hi >> (shift - 32);
+	if (!shift)
+		return v;
+	return ((u64)(hi >> shift) << 32) | (lo >> shift) | (hi << (32 - shift));
+}
+
+/* Nanoseconds since the last update */
+static notrace u64 vdso_get_ns(const struct vdso_data *vd)
+{
+	u32 cycles = *(const volatile u32 *)vd->cs_counter;
+	u32 delta = (cycles - vd->cs_cycle_last) & vd->cs_mask;
+
+	return vdso_shr((u64)delta * vd->cs_mult, vd->cs_shift);
+}
+
+static notrace void vdso_ts_set(struct timespec *ts, u32 sec, u64 nsec)
+{
+	while (nsec >= NSEC_PER_SEC) {
+		nsec -= NSEC_PER_SEC;
+		sec++;
+	}
+	ts->tv_sec = sec;
+	ts->tv_nsec = nsec;
+}
+
+/* Returns non-zero when the counter cannot be read from user space */
+static notrace int do_realtime(const struct vdso_data *vd,
+			       struct timespec *ts)
+{
+	u32 seq, sec;
+	u64 nsec;
+
+	do {
+		seq = vdso_read_begin(vd);
+		if (vd->use_syscall)
+			return -1;
+		sec = vd->xtime_sec;
+		nsec = vd->xtime_nsec + vdso_get_ns(vd);
+	} while (vdso_read_retry(vd, seq));
+
+	vdso_ts_set(ts, sec, nsec);
+	return 0;
+}
+
+static notrace int do_monotonic(const struct vdso_data *vd,
+				struct timespec *ts)
+{
+	u32 seq, sec;
+	u64 nsec;
+
+	do {
+		seq = vdso_read_begin(vd);
+		if (vd->use_syscall)
+			return -1;
+		sec = vd->xtime_sec + vd->wtm_sec;
+		nsec = (u64)vd->xtime_nsec + vd->wtm_nsec + vdso_get_ns(vd);
+	} while (vdso_read_retry(vd, seq));
+
+	vdso_ts_set(ts, sec, nsec);
+	return 0;
+}
+
+/* The coarse clocks are the time of the last tick */
+static notrace void do_realtime_coarse(const struct vdso_data *vd,
+				       struct timespec *ts)
+{
+	u32 seq, sec, nsec;
+
+	do {
+		seq = vdso_read_begin(vd);
+		sec = vd->xtime_sec;
+		nsec = vd->xtime_nsec;
+	} while (vdso_read_retry(vd, seq));
+
+	vdso_ts_set(ts, sec, nsec);
+}
+
+static notrace void do_monotonic_coarse(const struct vdso_data *vd,
+					struct timespec *ts)
+{
+	u32 seq, sec, nsec;
+
+	do {
+		seq = vdso_read_begin(vd);
+		sec = vd->xtime_sec + vd->wtm_sec;
+		nsec = vd->xtime_nsec + vd->wtm_nsec;
+	} while (vdso_read_retry(vd, seq));
+
+	vdso_ts_set(ts, sec, nsec);
+}
+
+notrace int __vdso_clock_gettime(clockid_t clkid, struct timespec *ts)
+{
+	const struct vdso_data *vd = __get_datapage();
+
+	switch (clkid) {
+	case CLOCK_REALTIME:
+		if (do_realtime(vd, ts))
+			break;
+		return 0;
+	case CLOCK_MONOTONIC:
+		if (do_monotonic(vd, ts))
+			break;
+		return 0;
+	case CLOCK_REALTIME_COARSE:
+		do_realtime_coarse(vd, ts);
+		return 0;
+	case CLOCK_MONOTONIC_COARSE:
+		do_monotonic_coarse(vd, ts);
+		return 0;
+	}
+	return clock_gettime_fallback(clkid, ts);
+}
+
+notrace int __vdso_gettimeofday(struct timeval *tv, struct timezone *tz)
+{
+	const struct vdso_data *vd = __get_datapage();
+	struct timespec ts;
+
+	if (tv) {
+		if (do_realtime(vd, &ts))
+			return gettimeofday_fallback(tv, tz);
+		tv->tv_sec = ts.tv_sec;
+		tv->tv_usec = (u32)ts.tv_nsec / 1000;
+	}
+	if (tz) {
+		tz->tz_minuteswest = vd->tz_minuteswest;
+		tz->tz_dsttime = vd->tz_dsttime;
+	}
+	return 0;
+}
@@ -0,0 +1,203 @@
+/*
+ *  linux/arch/arm/lib/checksum_neon.c
+ *
+ *  Dispatch of large csum_partial and csum_partial_copy_nocheck calls to
+ *  the NEON routines in csumpartial_neon.S.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/hardirq.h>
+#include <linux/gfp.h>
+#include <linux/hrtimer.h>
+#include <linux/math64.h>
+#include <linux/random.h>
+#include <linux/string.h>
+#include <net/checksum.h>
+#include <asm/neon.h>
+
+/* Integer routines, entered past the threshold check */
+extern __wsum __csum_partial_arm(const void *buff, int len, __wsum sum);
+extern __wsum __csum_partial_copy_arm(const void *src, void *dst, int len,
+				      __wsum sum);
+
+extern u64 __csum_partial_neon(const void *buf, unsigned int len);
+extern u64 __csum_partial_copy_neon(const void *src, void *dst,
+				    unsigned int len);
+
+/*
+ * csum_partial and csum_partial_copy_nocheck branch here for lengths of
+ * at least neon_csum_threshold bytes. It stays ~0 until NEON has been
+ * detected and the NEON routines have passed their self test.
+ */
+unsigned long neon_csum_threshold = ~0UL;
+
+/* ~0 picks the threshold from the boot time measurement */
+static unsigned long neon_csum_threshold_param __initdata = ~0UL;
+
+/* Largest piece handled with preemption disabled */
+#define NEON_CSUM_CHUNK		(16 * 1024)
+
+static inline __wsum csum_add_u64(__wsum sum, u64 s)
+{
+	sum = csum_add(sum, (__force __wsum)(u32)s);
+	return csum_add(sum, (__force __wsum)(u32)(s >> 32));
+}
+
+__wsum csum_partial_neon(const void *buff, int len, __wsum sum)
+{
+	if (in_interrupt())
+		return __csum_partial_arm(buff, len, sum);
+
+	/* Whole chunks keep the byte offset of the remainder even */
+	while (len >= 64) {
+		unsigned int n = min(len, NEON_CSUM_CHUNK) & ~63;
+		u64 s;
+
+		kernel_neon_begin();
+		s = __csum_partial_neon(buff, n);
+		kernel_neon_end();
+		sum = csum_add_u64(sum, s);
+		buff += n;
+		len -= n;
+	}
+	return len ? __csum_partial_arm(buff, len, sum) : sum;
+}
+
+__wsum csum_partial_copy_neon(const void *src, void *dst, int len, __wsum sum)
+{
+	if (in_interrupt())
+		return __csum_partial_copy_arm(src, dst, len, sum);
+
+	while (len >= 64) {
+		unsigned int n = min(len, NEON_CSUM_CHUNK) & ~63;
+		u64 s;
+
+		kernel_neon_begin();
+		s = __csum_partial_copy_neon(src, dst, n);
+		kernel_neon_end();
+		sum = csum_add_u64(sum, s);
+		src += n;
+		dst += n;
+		len -= n;
+	}
+	return len ? __csum_partial_copy_arm(src, dst, len, sum) : sum;
+}
+
+static int __init neon_csum_threshold_setup(char *str)
+{
+	neon_csum_threshold_param = memparse(str, &str);
+	return 1;
+}
+__setup("neon_csum_threshold=", neon_csum_threshold_setup);
+
+#define CSUM_TEST_SIZE		(2 * PAGE_SIZE)
+
+/* Ones' complement equality, where 0 and 0xffff are both zero */
+static bool __init csum_neon_equal(__wsum a, __wsum b)
+{
+	return (__force u16)csum_fold(a) % 0xffff ==
+	       (__force u16)csum_fold(b) % 0xffff;
+}
+
+/* Compare the NEON paths with the integer routines */
+static int __init csum_neon_selftest(u8 *src, u8 *dst)
+{
+	static const int lens[] __initconst = {
+		64, 65, 127, 576, 1500, 4095, 4096, 6000,
+	};
+	int i, off;
+
+	for (i = 0; i < ARRAY_SIZE(lens); i++) {
+		for (off = 0; off < 4; off++) {
+			int len = lens[i];
+			__wsum sum = (__force __wsum)random32();
+			__wsum ref, res;
+
+			ref = __csum_partial_arm(src + off, len, sum);
+			res = csum_partial_neon(src + off, len, sum);
+			if (!csum_neon_equal(ref, res))
+				return -EINVAL;
+
+			memset(dst, 0, len + 4);
+			res = csum_partial_copy_neon(src + off, dst + 3 - off,
+						     len, sum);
+			if (!csum_neon_equal(ref, res) ||
+			    memcmp(src + off, dst + 3 - off, len))
+				return -EINVAL;
+		}
+	}
+	return 0;
+}
+
+/* MB/s of @fn over @len byte buffers */
+static unsigned int __init csum_neon_speed(__wsum (*fn)(const void *, int,
+							 __wsum),
+					   const void *buf, int len)
+{
+	unsigned int i, loops = (256 * 1024) / len;
+	__wsum sum = 0;
+	ktime_t start;
+	s64 ns;
+
+	start = ktime_get();
+	for (i = 0; i < loops; i++)
+		sum = fn(buf, len, sum);
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	return ns ? div64_u64((u64)loops * len * 1000, ns) : 0;
+}
+
+/*
+ * Runs after vfp_init() has probed for NEON. Unless a threshold was given
+ * on the command line, pick the smallest measured length from which NEON
+ * stays faster than the integer loop.
+ */
+static int __init checksum_neon_init(void)
+{
+	static const int sizes[] __initconst = { 128, 256, 512, 1024, 4096 };
+	unsigned long threshold = ~0UL;
+	u8 *src, *dst;
+	int i;
+
+	if (!cpu_has_neon() || !neon_csum_threshold_param)
+		return 0;
+
+	src = (u8 *)__get_free_pages(GFP_KERNEL, 2);
+	if (!src)
+		return -ENOMEM;
+	dst = src + CSUM_TEST_SIZE;
+	get_random_bytes(src, CSUM_TEST_SIZE);
+
+	if (csum_neon_selftest(src, dst)) {
+		printk(KERN_ERR "NEON: checksum self test failed\n");
+		goto out;
+	}
+
+	for (i = ARRAY_SIZE(sizes) - 1; i >= 0; i--) {
+		unsigned int arm, neon;
+
+		arm = csum_neon_speed(__csum_partial_arm, src, sizes[i]);
+		neon = csum_neon_speed(csum_partial_neon, src, sizes[i]);
+		printk(KERN_INFO "NEON: csum_partial %4d bytes: "
+		       "arm %5u MB/s, neon %5u MB/s\n", sizes[i], arm, neon);
+		if (neon <= arm)
+			break;
+		threshold = sizes[i];
+	}
+
+	if (neon_csum_threshold_param != ~0UL)
+		threshold = max(neon_csum_threshold_param, 64UL);
+	neon_csum_threshold = threshold;
+	if (threshold != ~0UL)
+		printk(KERN_INFO "NEON: using NEON for checksums of %lu bytes "
+		       "or more\n", threshold);
+out:
+	free_pages((unsigned long)src, 2);
+	return 0;
+}
+late_initcall_sync(checksum_neon_init);
@@ -0,0 +1,125 @@
+/*
+ *  linux/arch/arm/lib/string_neon.c
+ *
+ *  Dispatch of large memcpy, memset and copy_page calls to the NEON
+ *  routines in memcpy_neon.S.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/hardirq.h>
+#include <asm/neon.h>
+#include <asm/page.h>
+
+extern void __memcpy_neon(void *dest, const void *src, size_t n);
+extern void __memset_neon(void *dest, int c, size_t n);
+extern void __copy_page_neon(void *to, const void *from);
+
+/*
+ * memcpy, memset and __memzero branch here for sizes of at least
+ * neon_copy_threshold bytes, copy_page does if it is at most PAGE_SIZE.
+ * It stays ~0 until NEON has been detected.
+ */
+unsigned long neon_copy_threshold = ~0UL;
+EXPORT_SYMBOL_GPL(neon_copy_threshold);
+
+static unsigned long neon_copy_threshold_param __initdata = 1024;
+
+/* Largest piece handled with preemption disabled */
+#define NEON_COPY_CHUNK		(16 * 1024)
+
+void *memcpy_neon(void *dest, const void *src, size_t n)
+{
+	void *d = dest;
+
+	if (in_interrupt())
+		return __memcpy_arm(dest, src, n);
+
+	while (n) {
+		size_t len = n >= 2 * NEON_COPY_CHUNK ? NEON_COPY_CHUNK : n;
+
+		kernel_neon_begin();
+		__memcpy_neon(d, src, len);
+		kernel_neon_end();
+		d += len;
+		src += len;
+		n -= len;
+	}
+	return dest;
+}
+EXPORT_SYMBOL_GPL(memcpy_neon);
+
+void *memset_neon(void *dest, int c, size_t n)
+{
+	void *d = dest;
+
+	if (in_interrupt()) {
+		__memset_arm(dest, c, n);
+		return dest;
+	}
+
+	while (n) {
+		size_t len = n >= 2 * NEON_COPY_CHUNK ? NEON_COPY_CHUNK : n;
+
+		kernel_neon_begin();
+		__memset_neon(d, c, len);
+		kernel_neon_end();
+		d += len;
+		n -= len;
+	}
+	return dest;
+}
+EXPORT_SYMBOL_GPL(memset_neon);
+
+void memzero_neon(void *dest, size_t n)
+{
+	if (in_interrupt())
+		__memzero_arm(dest, n);
+	else
+		memset_neon(dest, 0, n);
+}
+EXPORT_SYMBOL_GPL(memzero_neon);
+
+void copy_page_neon(void *to, const void *from)
+{
+	if (in_interrupt()) {
+		__copy_page_arm(to, from);
+		return;
+	}
+
+	kernel_neon_begin();
+	__copy_page_neon(to, from);
+	kernel_neon_end();
+}
+EXPORT_SYMBOL_GPL(copy_page_neon);
+
+/* For string_neon_bench */
+EXPORT_SYMBOL_GPL(__memcpy_arm);
+EXPORT_SYMBOL_GPL(__memset_arm);
+EXPORT_SYMBOL_GPL(__memzero_arm);
+EXPORT_SYMBOL_GPL(__copy_page_arm);
+
+static int __init neon_copy_threshold_setup(char *str)
+{
+	neon_copy_threshold_param = memparse(str, &str);
+	return 1;
+}
+__setup("neon_copy_threshold=", neon_copy_threshold_setup);
+
+/* Runs after vfp_init() has probed for NEON */
+static int __init string_neon_init(void)
+{
+	if (!cpu_has_neon() || !neon_copy_threshold_param)
+		return 0;
+
+	neon_copy_threshold = max(neon_copy_threshold_param, 64UL);
+	printk(KERN_INFO "NEON: using NEON for copies of %lu bytes or more\n",
+	       neon_copy_threshold);
+	return 0;
+}
+late_initcall_sync(string_neon_init);
@@ -0,0 +1,162 @@
+/*
+ *  linux/arch/arm/lib/string_neon_bench.c
+ *
+ *  Copy bandwidth benchmark for the integer and NEON string routines.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Loading the module times memcpy, memset, copy_page and clear_page with
+ * the integer routines and with the NEON ones, the latter including the
+ * kernel_neon_begin()/kernel_neon_end() cost, and reports MB/s for each.
+ * memcpy and memset run over buffer sizes from 64 bytes up to max_size,
+ * so that both the sizes around neon_copy_threshold and the ones that no
+ * longer fit in the L2 cache are covered:
+ *
+ *	insmod string_neon_bench.ko max_size=1048576 total_mb=64
+ *
+ * Like tcrypt, the module fails to load once it is done, so that it can be
+ * loaded again right away.
+ */
+
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/hrtimer.h>
+#include <linux/math64.h>
+#include <linux/mm.h>
+#include <linux/sched.h>
+#include <linux/vmalloc.h>
+#include <asm/neon.h>
+#include <asm/page.h>
+
+static unsigned int max_size = 1024 * 1024;
+module_param(max_size, uint, 0444);
+MODULE_PARM_DESC(max_size, "Largest memcpy and memset size");
+
+static unsigned int total_mb = 64;
+module_param(total_mb, uint, 0444);
+MODULE_PARM_DESC(total_mb, "Data processed per measurement, in MB");
+
+#define MIN_SIZE	64
+
+static void *src_buf, *dst_buf;
+
+enum bench_op { BENCH_MEMCPY, BENCH_MEMSET, BENCH_COPY_PAGE, BENCH_CLEAR_PAGE };
+
+static const char *bench_op_names[] = {
+	"memcpy", "memset", "copy_page", "clear_page",
+};
+
+static void bench_call(enum bench_op op, bool neon, void *dst, void *src,
+		       size_t size)
+{
+	switch (op) {
+	case BENCH_MEMCPY:
+		if (neon)
+			memcpy_neon(dst, src, size);
+		else
+			__memcpy_arm(dst, src, size);
+		break;
+	case BENCH_MEMSET:
+		if (neon)
+			memset_neon(dst, 0x5a, size);
+		else
+			__memset_arm(dst, 0x5a, size);
+		break;
+	case BENCH_COPY_PAGE:
+		if (neon)
+			copy_page_neon(dst, src);
+		else
+			__copy_page_arm(dst, src);
+		break;
+	case BENCH_CLEAR_PAGE:
+		/* clear_page() is __memzero() of a page */
+		if (neon)
+			memzero_neon(dst, PAGE_SIZE);
+		else
+			__memzero_arm(dst, PAGE_SIZE);
+		break;
+	}
+}
+
+/* MB/s of @op over buffers of @size bytes */
+static unsigned long bench_one(enum bench_op op, bool neon, size_t size)
+{
+	u64 bytes = (u64)total_mb << 20;
+	unsigned long i, loops, off = 0;
+	ktime_t start;
+	s64 ns;
+
+	loops = max_t(u64, div_u64(bytes, size), 1);
+	bytes = (u64)loops * size;
+
+	/* Warm the caches and the TLB */
+	bench_call(op, neon, dst_buf, src_buf, size);
+
+	start = ktime_get();
+	for (i = 0; i < loops; i++) {
+		bench_call(op, neon, dst_buf + off, src_buf + off, size);
+		/* Walk through the whole buffer for sizes that fit many times */
+		off += size;
+		if (off + size > max_size)
+			off = 0;
+	}
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	cond_resched();
+
+	return ns > 0 ? div64_u64(bytes * NSEC_PER_SEC, ns) >> 20 : 0;
+}
+
+static void bench_op(enum bench_op op)
+{
+	size_t size;
+
+	if (op == BENCH_COPY_PAGE || op == BENCH_CLEAR_PAGE) {
+		pr_info("string_neon_bench: %-10s %8lu: %6lu MB/s arm, "
+			"%6lu MB/s neon\n", bench_op_names[op], PAGE_SIZE,
+			bench_one(op, false, PAGE_SIZE),
+			bench_one(op, true, PAGE_SIZE));
+		return;
+	}
+
+	for (size = MIN_SIZE; size <= max_size; size <<= 2)
+		pr_info("string_neon_bench: %-10s %8zu: %6lu MB/s arm, "
+			"%6lu MB/s neon\n", bench_op_names[op], size,
+			bench_one(op, false, size), bench_one(op, true, size));
+}
+
+static int __init string_neon_bench_init(void)
+{
+	enum bench_op op;
+
+	if (!cpu_has_neon())
+		return -ENODEV;
+	if (max_size < PAGE_SIZE || !total_mb)
+		return -EINVAL;
+
+	/* Page aligned, as copy_page() expects */
+	src_buf = vmalloc(max_size);
+	dst_buf = vmalloc(max_size);
+	if (!src_buf || !dst_buf) {
+		vfree(src_buf);
+		vfree(dst_buf);
+		return -ENOMEM;
+	}
+	memset(src_buf, 0xa5, max_size);
+	memset(dst_buf, 0, max_size);
+
+	pr_info("string_neon_bench: neon_copy_threshold %lu\n",
+		neon_copy_threshold);
+	for (op = BENCH_MEMCPY; op <= BENCH_CLEAR_PAGE; op++)
+		bench_op(op);
+
+	vfree(src_buf);
+	vfree(dst_buf);
+	return -EAGAIN;
+}
+module_init(string_neon_bench_init);
+
+MODULE_DESCRIPTION("Integer and NEON string routine bandwidth benchmark");
+MODULE_LICENSE("GPL");
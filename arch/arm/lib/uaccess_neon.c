@@ -0,0 +1,145 @@
+/*
+ *  linux/arch/arm/lib/uaccess_neon.c
+ *
+ *  Dispatch of large __copy_from_user and __copy_to_user calls to the
+ *  NEON routines in copy_user_neon.S.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+#include <linux/kernel.h>
+#include <linux/hardirq.h>
+#include <linux/mm.h>
+#include <linux/string.h>
+#include <linux/uaccess.h>
+#include <asm/neon.h>
+
+/* Integer routines, entered past the threshold check */
+extern unsigned long __copy_from_user_std(void *to, const void __user *from,
+					  unsigned long n);
+
+extern unsigned long __copy_from_user_neon(void *to, const void __user *from,
+					   unsigned long n);
+extern unsigned long __copy_to_user_neon(void __user *to, const void *from,
+					 unsigned long n);
+
+/*
+ * __copy_from_user and __copy_to_user branch here for sizes of at least
+ * neon_copy_threshold bytes, see string_neon.c.
+ *
+ * The NEON routines run with page faults disabled, as preemption is off
+ * while the NEON unit is in use. When one of them stops on a fault, the
+ * integer routine copies up to the end of the faulting page, handling
+ * the fault the normal way, and the NEON copy resumes from there.
+ */
+
+/* Largest piece handled with preemption disabled */
+#define NEON_UACCESS_CHUNK	(16 * 1024)
+
+/* Like __copy_from_user_std, clears what could not be copied */
+static unsigned long copy_from_user_fault(void *to, const void __user *from,
+					  unsigned long len, unsigned long n)
+{
+	unsigned long left = __copy_from_user_std(to, from, len);
+
+	if (left) {
+		memset(to + len, 0, n - len);
+		left += n - len;
+	}
+	return left;
+}
+
+unsigned long copy_from_user_neon(void *to, const void __user *from,
+				  unsigned long n)
+{
+	unsigned long len, left;
+
+	if (in_interrupt())
+		return __copy_from_user_std(to, from, n);
+
+	/* Align the destination for the NEON stores */
+	len = -(unsigned long)to & 15;
+	if (len) {
+		left = copy_from_user_fault(to, from, len, n);
+		if (left)
+			return left;
+		to += len;
+		from += len;
+		n -= len;
+	}
+
+	while (n >= 64) {
+		len = min_t(unsigned long, n, NEON_UACCESS_CHUNK) & ~63UL;
+
+		pagefault_disable();
+		kernel_neon_begin();
+		left = __copy_from_user_neon(to, from, len);
+		kernel_neon_end();
+		pagefault_enable();
+
+		if (left) {
+			len -= left;
+			to += len;
+			from += len;
+			n -= len;
+
+			len = min_t(unsigned long, n,
+				    PAGE_SIZE - offset_in_page(from));
+			left = copy_from_user_fault(to, from, len, n);
+			if (left)
+				return left;
+		}
+		to += len;
+		from += len;
+		n -= len;
+	}
+	return n ? __copy_from_user_std(to, from, n) : 0;
+}
+
+unsigned long copy_to_user_neon(void __user *to, const void *from,
+				unsigned long n)
+{
+	unsigned long len, left;
+
+	if (in_interrupt())
+		return __copy_to_user_std(to, from, n);
+
+	len = -(unsigned long)to & 15;
+	if (len) {
+		left = __copy_to_user_std(to, from, len);
+		if (left)
+			return left + n - len;
+		to += len;
+		from += len;
+		n -= len;
+	}
+
+	while (n >= 64) {
+		len = min_t(unsigned long, n, NEON_UACCESS_CHUNK) & ~63UL;
+
+		pagefault_disable();
+		kernel_neon_begin();
+		left = __copy_to_user_neon(to, from, len);
+		kernel_neon_end();
+		pagefault_enable();
+
+		if (left) {
+			len -= left;
+			to += len;
+			from += len;
+			n -= len;
+
+			len = min_t(unsigned long, n,
+				    PAGE_SIZE - offset_in_page(to));
+			left = __copy_to_user_std(to, from, len);
+			if (left)
+				return left + n - len;
+		}
+		to += len;
+		from += len;
+		n -= len;
+	}
+	return n ? __copy_to_user_std(to, from, n) : 0;
+}
@@ -25,6 +25,7 @@
 #include <linux/omapfb.h>
 
 #include <asm/tlb.h>
+#include <asm/vdso.h>
 
 #include <asm/mach/map.h>
 
@@ -165,6 +166,15 @@ static struct map_desc omap34xx_io_desc[] __initdata = {
 		.length		= L4_EMU_34XX_SIZE,
 		.type		= MT_DEVICE
 	},
+#ifdef CONFIG_VDSO
+	{
+		/* 32k sync counter, read by the vDSO */
+		.virtual	= VDSO_COUNTER_PAGE,
+		.pfn		= __phys_to_pfn(OMAP3430_32KSYNCT_BASE),
+		.length		= SZ_4K,
+		.type		= MT_DEVICE_USER
+	},
+#endif
 #if defined(CONFIG_DEBUG_LL) &&							\
 	(defined(CONFIG_MACH_OMAP_ZOOM2) || defined(CONFIG_MACH_OMAP_ZOOM3))
 	{
@@ -12,29 +12,142 @@
 #include <linux/mm.h>
 #include <linux/smp.h>
 #include <linux/percpu.h>
+#include <linux/bitops.h>
+#include <linux/debugfs.h>
 
 #include <asm/mmu_context.h>
+#include <asm/smp_plat.h>
 #include <asm/tlbflush.h>
 
+/*
+ * mm->context.id holds the generation of its ASID in the bits above
+ * ASID_BITS. It is 64 bits wide, so the generation never wraps. An mm
+ * whose generation is current can be switched to without taking
+ * cpu_asid_lock. ASID 0 is reserved for the TTBR changing sequence, so
+ * NUM_USER_ASIDS are available to processes.
+ *
+ * When the bitmap of ASIDs runs out, the generation is bumped and the
+ * bitmap is rebuilt from the ASIDs active on each CPU, which stay
+ * reserved for their mm. Every other mm gets its old ASID back if it is
+ * still free when it next runs, or a new one otherwise. Instead of
+ * broadcasting a flush, each CPU invalidates its TLB once, when it next
+ * switches to an mm under the new generation.
+ */
+#define NUM_USER_ASIDS		(ASID_FIRST_VERSION - 1)
+#define ASID_TO_IDX(asid)	(((asid) & ~ASID_MASK) - 1)
+#define IDX_TO_ASID(idx)	((idx) + 1)
+
 static DEFINE_SPINLOCK(cpu_asid_lock);
-unsigned int cpu_last_asid = ASID_FIRST_VERSION;
-#ifdef CONFIG_SMP
-DEFINE_PER_CPU(struct mm_struct *, current_mm);
-#endif
+static atomic64_t asid_generation = ATOMIC64_INIT(ASID_FIRST_VERSION);
+static DECLARE_BITMAP(asid_map, NUM_USER_ASIDS);
+
+static DEFINE_PER_CPU(atomic64_t, active_asids);
+static DEFINE_PER_CPU(u64, reserved_asids);
+static cpumask_t tlb_flush_pending;
+
+static u32 asid_rollovers;
+static u32 asid_tlb_flushes;
+static u32 asid_allocs;
+static u32 asid_reuses;
 
 /*
  * We fork()ed a process, and we need a new context for the child
- * to run in.  We reserve version 0 for initial tasks so we will
- * always allocate an ASID. The ASID 0 is reserved for the TTBR
- * register changing sequence.
+ * to run in.  Generation 0 is never current, so the child allocates
+ * an ASID on its first switch.
  */
 void __init_new_context(struct task_struct *tsk, struct mm_struct *mm)
 {
-	mm->context.id = 0;
-	spin_lock_init(&mm->context.id_lock);
+	atomic64_set(&mm->context.id, 0);
 }
 
-static void flush_context(void)
+/* Start a new generation. Called with cpu_asid_lock held. */
+static void flush_context(unsigned int cpu)
+{
+	u64 asid;
+	int i;
+
+	bitmap_zero(asid_map, NUM_USER_ASIDS);
+	for_each_possible_cpu(i) {
+		if (i == cpu) {
+			asid = 0;
+		} else {
+			asid = atomic64_xchg(&per_cpu(active_asids, i), 0);
+			/*
+			 * A CPU that has been through a rollover without
+			 * switching mm since still runs its reserved ASID.
+			 */
+			if (asid == 0)
+				asid = per_cpu(reserved_asids, i);
+			if (asid)
+				__set_bit(ASID_TO_IDX(asid), asid_map);
+		}
+		per_cpu(reserved_asids, i) = asid;
+	}
+
+	if (!tlb_ops_need_broadcast())
+		cpumask_set_cpu(cpu, &tlb_flush_pending);
+	else
+		cpumask_setall(&tlb_flush_pending);
+	asid_rollovers++;
+}
+
+/*
+ * Move the reservations of @asid to @newasid. A CPU can keep running the
+ * same mm across several rollovers, so its reserved entry has to follow
+ * the generation that mm->context.id is given. Otherwise the next
+ * rollover would not find it and would hand the mm a second ASID while
+ * the first one is still live in that CPU's TLB.
+ */
+static bool check_update_reserved_asid(u64 asid, u64 newasid)
+{
+	bool hit = false;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		if (per_cpu(reserved_asids, cpu) == asid) {
+			per_cpu(reserved_asids, cpu) = newasid;
+			hit = true;
+		}
+	}
+	return hit;
+}
+
+/* Pick an ASID of the current generation for @mm, with cpu_asid_lock held */
+static u64 new_context(struct mm_struct *mm, unsigned int cpu)
+{
+	u64 asid = atomic64_read(&mm->context.id);
+	u64 generation = atomic64_read(&asid_generation);
+	unsigned int idx;
+
+	if (asid != 0) {
+		u64 newasid = generation | (asid & ~ASID_MASK);
+
+		/* Still running on some CPU: it kept its ASID */
+		if (check_update_reserved_asid(asid, newasid)) {
+			asid_reuses++;
+			return newasid;
+		}
+		/* Take the old ASID back if nobody got it yet */
+		if (!__test_and_set_bit(ASID_TO_IDX(asid), asid_map)) {
+			asid_reuses++;
+			return newasid;
+		}
+	}
+
+	idx = find_first_zero_bit(asid_map, NUM_USER_ASIDS);
+	if (idx == NUM_USER_ASIDS) {
+		generation = atomic64_add_return(ASID_FIRST_VERSION,
+						 &asid_generation);
+		flush_context(cpu);
+		idx = find_first_zero_bit(asid_map, NUM_USER_ASIDS);
+	}
+	__set_bit(idx, asid_map);
+	asid_allocs++;
+	cpumask_clear(mm_cpumask(mm));
+	return generation | IDX_TO_ASID(idx);
+}
+
+static void local_flush_context(void)
 {
 	/* set the reserved ASID before flushing the TLB */
 	asm("mcr	p15, 0, %0, c13, c0, 1\n" : : "r" (0));
@@ -44,113 +157,56 @@ static void flush_context(void)
 		__flush_icache_all();
 		dsb();
 	}
+	asid_tlb_flushes++;
 }
 
-#ifdef CONFIG_SMP
-
-static void set_mm_context(struct mm_struct *mm, unsigned int asid)
+void check_and_switch_context(struct mm_struct *mm, struct task_struct *tsk)
 {
+	unsigned int cpu = smp_processor_id();
 	unsigned long flags;
-
-	/*
-	 * Locking needed for multi-threaded applications where the
-	 * same mm->context.id could be set from different CPUs during
-	 * the broadcast. This function is also called via IPI so the
-	 * mm->context.id_lock has to be IRQ-safe.
-	 */
-	spin_lock_irqsave(&mm->context.id_lock, flags);
-	if (likely((mm->context.id ^ cpu_last_asid) >> ASID_BITS)) {
-		/*
-		 * Old version of ASID found. Set the new one and
-		 * reset mm_cpumask(mm).
-		 */
-		mm->context.id = asid;
-		cpumask_clear(mm_cpumask(mm));
+	u64 asid;
+
+	if (unlikely(mm->context.kvm_seq != init_mm.context.kvm_seq))
+		__check_kvm_seq(mm);
+
+	asid = atomic64_read(&mm->context.id);
+	if (!((asid ^ atomic64_read(&asid_generation)) >> ASID_BITS) &&
+	    atomic64_xchg(&per_cpu(active_asids, cpu), asid))
+		goto switch_mm_fastpath;
+
+	spin_lock_irqsave(&cpu_asid_lock, flags);
+	/* Check that our ASID belongs to the current generation */
+	asid = atomic64_read(&mm->context.id);
+	if ((asid ^ atomic64_read(&asid_generation)) >> ASID_BITS) {
+		asid = new_context(mm, cpu);
+		atomic64_set(&mm->context.id, asid);
 	}
-	spin_unlock_irqrestore(&mm->context.id_lock, flags);
-
-	/*
-	 * Set the mm_cpumask(mm) bit for the current CPU.
-	 */
-	cpumask_set_cpu(smp_processor_id(), mm_cpumask(mm));
-}
-
-/*
- * Reset the ASID on the current CPU. This function call is broadcast
- * from the CPU handling the ASID rollover and holding cpu_asid_lock.
- */
-static void reset_context(void *info)
-{
-	unsigned int asid;
-	unsigned int cpu = smp_processor_id();
-	struct mm_struct *mm = per_cpu(current_mm, cpu);
 
-	/*
-	 * Check if a current_mm was set on this CPU as it might still
-	 * be in the early booting stages and using the reserved ASID.
-	 */
-	if (!mm)
-		return;
+	if (cpumask_test_and_clear_cpu(cpu, &tlb_flush_pending))
+		local_flush_context();
 
-	smp_rmb();
-	asid = cpu_last_asid + cpu + 1;
+	atomic64_set(&per_cpu(active_asids, cpu), asid);
+	cpumask_set_cpu(cpu, mm_cpumask(mm));
+	spin_unlock_irqrestore(&cpu_asid_lock, flags);
 
-	flush_context();
-	set_mm_context(mm, asid);
-
-	/* set the new ASID */
+switch_mm_fastpath:
 	cpu_switch_mm(mm->pgd, mm);
 }
 
-#else
-
-static inline void set_mm_context(struct mm_struct *mm, unsigned int asid)
+#ifdef CONFIG_DEBUG_FS
+static int __init asid_debug_init(void)
 {
-	mm->context.id = asid;
-	cpumask_copy(mm_cpumask(mm), cpumask_of(smp_processor_id()));
-}
+	struct dentry *dir;
 
-#endif
+	dir = debugfs_create_dir("asid", NULL);
+	if (!dir)
+		return -ENOMEM;
 
-void __new_context(struct mm_struct *mm)
-{
-	unsigned int asid;
-
-	spin_lock(&cpu_asid_lock);
-#ifdef CONFIG_SMP
-	/*
-	 * Check the ASID again, in case the change was broadcast from
-	 * another CPU before we acquired the lock.
-	 */
-	if (unlikely(((mm->context.id ^ cpu_last_asid) >> ASID_BITS) == 0)) {
-		cpumask_set_cpu(smp_processor_id(), mm_cpumask(mm));
-		spin_unlock(&cpu_asid_lock);
-		return;
-	}
-#endif
-	/*
-	 * At this point, it is guaranteed that the current mm (with
-	 * an old ASID) isn't active on any other CPU since the ASIDs
-	 * are changed simultaneously via IPI.
-	 */
-	asid = ++cpu_last_asid;
-	if (asid == 0)
-		asid = cpu_last_asid = ASID_FIRST_VERSION;
-
-	/*
-	 * If we've used up all our ASIDs, we need
-	 * to start a new version and flush the TLB.
-	 */
-	if (unlikely((asid & ~ASID_MASK) == 0)) {
-		asid = cpu_last_asid + smp_processor_id() + 1;
-		flush_context();
-#ifdef CONFIG_SMP
-		smp_wmb();
-		smp_call_function(reset_context, NULL, 1);
-#endif
-		cpu_last_asid += NR_CPUS;
-	}
-
-	set_mm_context(mm, asid);
-	spin_unlock(&cpu_asid_lock);
+	debugfs_create_u32("rollovers", 0444, dir, &asid_rollovers);
+	debugfs_create_u32("tlb_flushes", 0444, dir, &asid_tlb_flushes);
+	debugfs_create_u32("allocations", 0444, dir, &asid_allocs);
+	debugfs_create_u32("reuses", 0444, dir, &asid_reuses);
+	return 0;
 }
+late_initcall(asid_debug_init);
+#endif
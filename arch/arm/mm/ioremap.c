@@ -187,6 +187,206 @@ remap_area_supersections(unsigned long virt, unsigned long pfn,
 }
 #endif
 
+/*
+ * Large page support.  Sixteen hardware PTEs mapping a 64K aligned,
+ * physically contiguous block with identical attributes can be replaced
+ * by sixteen copies of a large page descriptor, which takes a single TLB
+ * entry.  Only the hardware table is rewritten, the Linux PTEs stay as
+ * they were, so the generic code sees ordinary pages.
+ *
+ * Any later set_pte_ext() on one of these PTEs writes back a small page
+ * entry.  Leaving the rest of the block as a large page would let the
+ * TLB hold entries of both sizes for the same address, so a block may
+ * only be changed as a whole, followed by a TLB flush: this is the case
+ * for vunmap() and munmap() of whole mappings.  Splitting a mapping
+ * inside a block needs split_large_pages() first, and mprotect() and
+ * mremap(), which rewrite the PTEs of a range one at a time, need
+ * split_large_pages_range().
+ *
+ * The v6 extended small page format is converted, so this needs XP.
+ */
+#define LARGE_PAGE_PTRS		(LARGE_PAGE_SIZE >> PAGE_SHIFT)
+
+/* Attribute bits found at the same place in small and large pages */
+#define PTE_LARGE_SAME		(PTE_BUFFERABLE | PTE_CACHEABLE | \
+				 PTE_EXT_AP_MASK | PTE_EXT_APX | \
+				 PTE_EXT_SHARED | PTE_EXT_NG)
+
+static inline int large_pages_supported(void)
+{
+	return cpu_architecture() >= CPU_ARCH_ARMv6 && (get_cr() & CR_XP);
+}
+
+static inline u32 *pte_hw(pte_t *ptep)
+{
+	return (u32 *)(ptep + PTE_HWTABLE_PTRS);
+}
+
+/* Turn the block starting at @ptep into a large page if it qualifies */
+static int pte_block_mklarge(pte_t *ptep)
+{
+	u32 *hw = pte_hw(ptep);
+	u32 small = hw[0], large;
+	int i;
+
+	if (!(small & PTE_TYPE_SMALL) ||
+	    (small & PAGE_MASK & ~LARGE_PAGE_MASK))
+		return 0;
+	for (i = 1; i < LARGE_PAGE_PTRS; i++)
+		if (hw[i] != small + i * PAGE_SIZE)
+			return 0;
+
+	large = (small & LARGE_PAGE_MASK) | (small & PTE_LARGE_SAME) |
+		PTE_LARGE_TEX((small >> 6) & 7) | PTE_TYPE_LARGE;
+	if (small & PTE_EXT_XN)
+		large |= PTE_LARGE_XN;
+
+	for (i = 0; i < LARGE_PAGE_PTRS; i++)
+		hw[i] = large;
+	clean_dcache_area(hw, LARGE_PAGE_PTRS * sizeof(u32));
+	return 1;
+}
+
+/*
+ * Turn the large page at @ptep back into small pages.  The entries are
+ * cleared and the TLB flushed before the small pages are written, so
+ * that the TLB never holds both.
+ */
+static void pte_block_mksmall(struct vm_area_struct *vma,
+			      unsigned long addr, pte_t *ptep)
+{
+	u32 *hw = pte_hw(ptep);
+	u32 large = hw[0], small;
+	int i;
+
+	if ((large & PTE_TYPE_MASK) != PTE_TYPE_LARGE)
+		return;
+
+	small = (large & LARGE_PAGE_MASK) | (large & PTE_LARGE_SAME) |
+		PTE_EXT_TEX((large >> 12) & 7) | PTE_TYPE_SMALL;
+	if (large & PTE_LARGE_XN)
+		small |= PTE_EXT_XN;
+
+	memset(hw, 0, LARGE_PAGE_PTRS * sizeof(u32));
+	clean_dcache_area(hw, LARGE_PAGE_PTRS * sizeof(u32));
+	flush_tlb_page(vma, addr);
+
+	for (i = 0; i < LARGE_PAGE_PTRS; i++)
+		hw[i] = small + i * PAGE_SIZE;
+	clean_dcache_area(hw, LARGE_PAGE_PTRS * sizeof(u32));
+}
+
+/*
+ * Promote the large page aligned blocks of the populated kernel range
+ * [addr, end).  The range is fresh from get_vm_area(), so the TLB holds
+ * nothing for it yet.
+ */
+static void remap_area_large_pages(unsigned long addr, unsigned long end)
+{
+	addr = ALIGN(addr, LARGE_PAGE_SIZE);
+	end &= LARGE_PAGE_MASK;
+
+	for (; addr < end; addr += LARGE_PAGE_SIZE) {
+		pmd_t *pmd = pmd_offset(pgd_offset_k(addr), addr);
+
+		if (pmd_none(*pmd) || pmd_bad(*pmd))
+			continue;
+		pte_block_mklarge(pte_offset_kernel(pmd, addr));
+	}
+}
+
+int remap_pfn_range_large(struct vm_area_struct *vma, unsigned long addr,
+			  unsigned long pfn, unsigned long size, pgprot_t prot)
+{
+	struct mm_struct *mm = vma->vm_mm;
+	unsigned long end = addr + PAGE_ALIGN(size);
+	int err;
+
+	/*
+	 * A write to a private mapping replaces a single page, and the first
+	 * write to a clean shared page rewrites its PTE.  Only shared or
+	 * read-only mappings qualify, and writable ones start out dirty.
+	 */
+	if (!large_pages_supported() ||
+	    (vma->vm_flags & (VM_SHARED | VM_MAYWRITE)) == VM_MAYWRITE)
+		return remap_pfn_range(vma, addr, pfn, size, prot);
+	if (vma->vm_flags & VM_WRITE)
+		prot = __pgprot(pgprot_val(prot) | L_PTE_DIRTY);
+
+	err = remap_pfn_range(vma, addr, pfn, size, prot);
+	if (err)
+		return err;
+
+	addr = ALIGN(addr, LARGE_PAGE_SIZE);
+	end &= LARGE_PAGE_MASK;
+
+	for (; addr < end; addr += LARGE_PAGE_SIZE) {
+		pmd_t *pmd = pmd_offset(pgd_offset(mm, addr), addr);
+		spinlock_t *ptl;
+		pte_t *pte;
+
+		if (pmd_none(*pmd) || pmd_bad(*pmd))
+			continue;
+		pte = pte_offset_map_lock(mm, pmd, addr, &ptl);
+		pte_block_mklarge(pte);
+		pte_unmap_unlock(pte, ptl);
+	}
+	return 0;
+}
+EXPORT_SYMBOL(remap_pfn_range_large);
+
+/* Break up the large page containing @addr, if there is one */
+static void split_large_page(struct vm_area_struct *vma, unsigned long addr)
+{
+	struct mm_struct *mm = vma->vm_mm;
+	pmd_t *pmd;
+	spinlock_t *ptl;
+	pte_t *pte;
+
+	addr &= LARGE_PAGE_MASK;
+
+	pmd = pmd_offset(pgd_offset(mm, addr), addr);
+	if (pmd_none(*pmd) || pmd_bad(*pmd))
+		return;
+	pte = pte_offset_map_lock(mm, pmd, addr, &ptl);
+	pte_block_mksmall(vma, addr, pte);
+	pte_unmap_unlock(pte, ptl);
+}
+
+/*
+ * vm_ops->open() of a mapping set up with remap_pfn_range_large().  When
+ * a mapping is split, this runs for the new part before either part is
+ * changed: break up the large pages straddling its ends.  A copy made
+ * by fork() has no PTEs yet, and gets small pages from copy_page_range().
+ */
+void split_large_pages(struct vm_area_struct *vma)
+{
+	if (!large_pages_supported())
+		return;
+	if (vma->vm_start & ~LARGE_PAGE_MASK)
+		split_large_page(vma, vma->vm_start);
+	if (vma->vm_end & ~LARGE_PAGE_MASK)
+		split_large_page(vma, vma->vm_end);
+}
+EXPORT_SYMBOL(split_large_pages);
+
+/*
+ * Break up every large page of @vma in [start, end), before mprotect()
+ * or mremap() rewrite its PTEs one by one.  Only remap_pfn_range_large()
+ * creates large pages, so other than VM_PFNMAP mappings have none.
+ */
+void split_large_pages_range(struct vm_area_struct *vma, unsigned long start,
+			     unsigned long end)
+{
+	unsigned long addr;
+
+	if (!large_pages_supported() || !(vma->vm_flags & VM_PFNMAP))
+		return;
+	for (addr = start & LARGE_PAGE_MASK; addr < end;
+	     addr += LARGE_PAGE_SIZE)
+		split_large_page(vma, addr);
+}
+
 void __iomem * __arm_ioremap_pfn_caller(unsigned long pfn,
 	unsigned long offset, size_t size, unsigned int mtype, void *caller)
 {
@@ -233,8 +433,12 @@ void __iomem * __arm_ioremap_pfn_caller(unsigned long pfn,
 		err = remap_area_sections(addr, pfn, size, type);
 	} else
 #endif
+	{
 		err = ioremap_page_range(addr, addr + size, __pfn_to_phys(pfn),
 					 __pgprot(type->prot_pte));
+		if (!err && large_pages_supported())
+			remap_area_large_pages(addr, addr + size);
+	}
 
 	if (err) {
  		vunmap((void *)addr);
@@ -20,6 +20,7 @@
 #include <linux/sched.h>
 
 #include <asm/sched_clock.h>
+#include <asm/vdso.h>
 
 #include <plat/common.h>
 #include <plat/board.h>
@@ -202,6 +203,12 @@ int __init omap_init_clocksource_32k(void)
 
 		offset_32k = clocksource_32k.read(&clocksource_32k);
 
+		/* The vDSO reads the counter through VDSO_COUNTER_PAGE */
+		if (cpu_is_omap34xx())
+			vdso_register_clocksource(&clocksource_32k,
+						  VDSO_COUNTER_PAGE + 0x10,
+						  offset_32k);
+
 		if (clocksource_register_hz(&clocksource_32k, 32768))
 			printk(err, clocksource_32k.name);
 
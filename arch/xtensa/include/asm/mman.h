@@ -86,6 +86,9 @@
 #define MADV_HUGEPAGE	14		/* Worth backing with hugepages */
 #define MADV_NOHUGEPAGE	15		/* Not worth backing with hugepages */
 
+/* Local extension, numbered away from values used by mainline */
+#define MADV_MERGEABLE_HOT 200		/* KSM should merge these pages first */
+
 /* compatibility flags */
 #define MAP_FILE	0
 
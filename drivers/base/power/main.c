@@ -19,6 +19,7 @@
 
 #include <linux/device.h>
 #include <linux/kallsyms.h>
+#include <linux/moduleparam.h>
 #include <linux/mutex.h>
 #include <linux/pm.h>
 #include <linux/pm_runtime.h>
@@ -26,6 +27,7 @@
 #include <linux/interrupt.h>
 #include <linux/sched.h>
 #include <linux/async.h>
+#include <linux/slab.h>
 #include <linux/suspend.h>
 #include <linux/timer.h>
 
@@ -58,6 +60,31 @@ struct dpm_drv_wd_data {
 
 static int async_error;
 
+/*
+ * Resume every device asynchronously, not only the ones that have set
+ * power.async_suspend. Ordering is then guaranteed only by parent/child
+ * relationships and by the links added with device_pm_add_supplier().
+ */
+static bool pm_async_resume_all;
+core_param(pm_async_resume_all, pm_async_resume_all, bool, 0644);
+
+/*
+ * A supplier link makes @consumer resume after, and suspend before,
+ * @supplier, in addition to the ordering implied by the device tree.
+ * Links are protected by dpm_links_lock so that they can be walked from
+ * async suspend/resume threads without taking dpm_list_mtx.
+ */
+struct dpm_link {
+	struct device		*supplier;
+	struct device		*consumer;
+	struct list_head	s_node;		/* in consumer->power.suppliers */
+	struct list_head	c_node;		/* in supplier->power.consumers */
+};
+
+static DEFINE_SPINLOCK(dpm_links_lock);
+
+static void dpm_reorder_consumers(struct device *dev);
+
 /**
  * device_pm_init - Initialize the PM-related part of a device object.
  * @dev: Device object being initialized.
@@ -72,6 +99,8 @@ void device_pm_init(struct device *dev)
 	spin_lock_init(&dev->power.lock);
 	pm_runtime_init(dev);
 	INIT_LIST_HEAD(&dev->power.entry);
+	INIT_LIST_HEAD(&dev->power.suppliers);
+	INIT_LIST_HEAD(&dev->power.consumers);
 }
 
 /**
@@ -103,9 +132,37 @@ void device_pm_add(struct device *dev)
 		dev_warn(dev, "parent %s should not be sleeping\n",
 			dev_name(dev->parent));
 	list_add_tail(&dev->power.entry, &dpm_list);
+	dpm_reorder_consumers(dev);
 	mutex_unlock(&dpm_list_mtx);
 }
 
+static void dpm_free_link(struct dpm_link *link)
+{
+	spin_lock_irq(&dpm_links_lock);
+	list_del(&link->s_node);
+	list_del(&link->c_node);
+	spin_unlock_irq(&dpm_links_lock);
+	put_device(link->supplier);
+	put_device(link->consumer);
+	kfree(link);
+}
+
+/**
+ * dpm_drop_links - Remove all supplier links @dev takes part in.
+ * @dev: Device being removed.
+ *
+ * Called with dpm_list_mtx held.
+ */
+static void dpm_drop_links(struct device *dev)
+{
+	struct dpm_link *link, *n;
+
+	list_for_each_entry_safe(link, n, &dev->power.suppliers, s_node)
+		dpm_free_link(link);
+	list_for_each_entry_safe(link, n, &dev->power.consumers, c_node)
+		dpm_free_link(link);
+}
+
 /**
  * device_pm_remove - Remove a device from the PM core's list of active devices.
  * @dev: Device to be removed from the list.
@@ -117,6 +174,7 @@ void device_pm_remove(struct device *dev)
 	complete_all(&dev->power.completion);
 	mutex_lock(&dpm_list_mtx);
 	list_del_init(&dev->power.entry);
+	dpm_drop_links(dev);
 	mutex_unlock(&dpm_list_mtx);
 	device_wakeup_disable(dev);
 	pm_runtime_remove(dev);
@@ -161,6 +219,156 @@ void device_pm_move_last(struct device *dev)
 	list_move_tail(&dev->power.entry, &dpm_list);
 }
 
+static int dpm_is_dependent_fn(struct device *dev, void *target);
+
+/**
+ * dpm_is_dependent - Check if @target has to be resumed after @dev.
+ * @dev: Device to start from.
+ * @target: Device to look for among @dev's descendants and consumers.
+ *
+ * Called with dpm_list_mtx held.
+ */
+static int dpm_is_dependent(struct device *dev, void *target)
+{
+	struct dpm_link *link;
+
+	if (dev == target)
+		return 1;
+	if (device_for_each_child(dev, target, dpm_is_dependent_fn))
+		return 1;
+	list_for_each_entry(link, &dev->power.consumers, c_node)
+		if (dpm_is_dependent(link->consumer, target))
+			return 1;
+	return 0;
+}
+
+static int dpm_is_dependent_fn(struct device *dev, void *target)
+{
+	return dpm_is_dependent(dev, target);
+}
+
+static int dpm_reorder_to_tail_fn(struct device *dev, void *not_used);
+
+/**
+ * dpm_reorder_to_tail - Move @dev and everything that depends on it last.
+ * @dev: Device to move in dpm_list.
+ *
+ * Called with dpm_list_mtx held.
+ */
+static void dpm_reorder_to_tail(struct device *dev)
+{
+	struct dpm_link *link;
+
+	device_pm_move_last(dev);
+	device_for_each_child(dev, NULL, dpm_reorder_to_tail_fn);
+	list_for_each_entry(link, &dev->power.consumers, c_node)
+		dpm_reorder_to_tail(link->consumer);
+}
+
+static int dpm_reorder_to_tail_fn(struct device *dev, void *not_used)
+{
+	dpm_reorder_to_tail(dev);
+	return 0;
+}
+
+/*
+ * Synchronous suspend and resume follow dpm_list order, so a consumer and
+ * everything depending on it must come after its supplier. The list can't
+ * be reordered during a transition. Called with dpm_list_mtx held.
+ */
+static void dpm_reorder_to_tail_if_idle(struct device *consumer)
+{
+	if (!consumer->power.is_prepared && !list_empty(&consumer->power.entry))
+		dpm_reorder_to_tail(consumer);
+}
+
+/**
+ * dpm_reorder_consumers - Move consumers of a new device behind it.
+ * @dev: Device just added to dpm_list.
+ *
+ * Links can be added before the supplier is registered, in which case its
+ * consumers ended up in dpm_list before it. Called with dpm_list_mtx held.
+ */
+static void dpm_reorder_consumers(struct device *dev)
+{
+	struct dpm_link *link;
+
+	list_for_each_entry(link, &dev->power.consumers, c_node)
+		dpm_reorder_to_tail_if_idle(link->consumer);
+}
+
+/**
+ * device_pm_add_supplier - Make a device's PM callbacks depend on another one.
+ * @consumer: Device that needs @supplier to be operational.
+ * @supplier: Device @consumer depends on.
+ *
+ * After this call @consumer is resumed only after @supplier has been resumed
+ * and @supplier is suspended only after @consumer has been suspended, both
+ * for synchronous and asynchronous suspend/resume. This is needed when
+ * pm_async_resume_all is set and a device depends on another one that is
+ * not its ancestor, e.g. an I2C client supplied by a regulator.
+ */
+int device_pm_add_supplier(struct device *consumer, struct device *supplier)
+{
+	struct dpm_link *link;
+	int error = 0;
+
+	if (!consumer || !supplier || consumer == supplier)
+		return -EINVAL;
+
+	link = kzalloc(sizeof(*link), GFP_KERNEL);
+	if (!link)
+		return -ENOMEM;
+
+	mutex_lock(&dpm_list_mtx);
+	if (dpm_is_dependent(consumer, supplier)) {
+		dev_warn(consumer, "supplier %s depends on this device\n",
+			 dev_name(supplier));
+		error = -EINVAL;
+		goto out;
+	}
+
+	link->supplier = get_device(supplier);
+	link->consumer = get_device(consumer);
+	spin_lock_irq(&dpm_links_lock);
+	list_add_tail(&link->s_node, &consumer->power.suppliers);
+	list_add_tail(&link->c_node, &supplier->power.consumers);
+	spin_unlock_irq(&dpm_links_lock);
+	link = NULL;
+
+	/*
+	 * If @supplier is not in dpm_list yet, device_pm_add() moves
+	 * @consumer behind it when it gets there.
+	 */
+	if (!list_empty(&supplier->power.entry))
+		dpm_reorder_to_tail_if_idle(consumer);
+
+ out:
+	mutex_unlock(&dpm_list_mtx);
+	kfree(link);
+	return error;
+}
+EXPORT_SYMBOL_GPL(device_pm_add_supplier);
+
+/**
+ * device_pm_remove_supplier - Drop a link added by device_pm_add_supplier().
+ * @consumer: Consumer device of the link.
+ * @supplier: Supplier device of the link.
+ */
+void device_pm_remove_supplier(struct device *consumer, struct device *supplier)
+{
+	struct dpm_link *link;
+
+	mutex_lock(&dpm_list_mtx);
+	list_for_each_entry(link, &consumer->power.suppliers, s_node)
+		if (link->supplier == supplier) {
+			dpm_free_link(link);
+			break;
+		}
+	mutex_unlock(&dpm_list_mtx);
+}
+EXPORT_SYMBOL_GPL(device_pm_remove_supplier);
+
 static ktime_t initcall_debug_start(struct device *dev)
 {
 	ktime_t calltime = ktime_set(0, 0);
@@ -187,17 +395,28 @@ static void initcall_debug_report(struct device *dev, ktime_t calltime,
 	}
 }
 
+static bool is_async(struct device *dev)
+{
+	return (dev->power.async_suspend || pm_async_resume_all)
+		&& pm_async_enabled && !pm_trace_is_enabled();
+}
+
 /**
  * dpm_wait - Wait for a PM operation to complete.
  * @dev: Device to wait for.
- * @async: If unset, wait only if the device's power.async_suspend flag is set.
+ * @async: If unset, wait only if the device is handled asynchronously.
+ *
+ * A synchronous caller need not wait for a synchronous device, which comes
+ * earlier in dpm_list and has been handled already, but must wait for one
+ * running asynchronously, including the devices pm_async_resume_all makes
+ * asynchronous without power.async_suspend set.
  */
 static void dpm_wait(struct device *dev, bool async)
 {
 	if (!dev)
 		return;
 
-	if (async || (pm_async_enabled && dev->power.async_suspend))
+	if (async || is_async(dev))
 		wait_for_completion(&dev->power.completion);
 }
 
@@ -212,6 +431,53 @@ static void dpm_wait_for_children(struct device *dev, bool async)
        device_for_each_child(dev, &async, dpm_wait_fn);
 }
 
+/**
+ * dpm_wait_for_links - Wait for the suppliers or consumers of a device.
+ * @dev: Device to handle.
+ * @consumers: Wait for consumers (suspend) instead of suppliers (resume).
+ * @async: If unset, wait only for devices handled asynchronously.
+ *
+ * The link lists can't be walked with dpm_links_lock held while waiting, so
+ * take a reference to one device at a time and rescan from the position
+ * reached. Links are rarely changed and devices have few of them.
+ */
+static void dpm_wait_for_links(struct device *dev, bool consumers, bool async)
+{
+	struct dpm_link *link;
+	struct device *other;
+	int i, n = 0;
+
+	if (list_empty(consumers ? &dev->power.consumers :
+				   &dev->power.suppliers))
+		return;
+
+	for (;;) {
+		other = NULL;
+		i = 0;
+		spin_lock_irq(&dpm_links_lock);
+		if (consumers) {
+			list_for_each_entry(link, &dev->power.consumers, c_node)
+				if (i++ == n) {
+					other = get_device(link->consumer);
+					break;
+				}
+		} else {
+			list_for_each_entry(link, &dev->power.suppliers, s_node)
+				if (i++ == n) {
+					other = get_device(link->supplier);
+					break;
+				}
+		}
+		spin_unlock_irq(&dpm_links_lock);
+		if (!other)
+			break;
+
+		dpm_wait(other, async);
+		put_device(other);
+		n++;
+	}
+}
+
 /**
  * pm_op - Execute the PM operation appropriate for given PM event.
  * @dev: Device to handle.
@@ -427,6 +693,7 @@ static void dpm_show_time(ktime_t starttime, pm_message_t state, char *info)
  */
 static int device_resume_noirq(struct device *dev, pm_message_t state)
 {
+	ktime_t enter = ktime_get();
 	int error = 0;
 
 	TRACE_DEVICE(dev);
@@ -446,6 +713,9 @@ static int device_resume_noirq(struct device *dev, pm_message_t state)
 		error = pm_noirq_op(dev, dev->bus->pm, state);
 	}
 
+	dpm_timing_record(dev, DPM_PHASE_RESUME_NOIRQ, enter, enter, false,
+			  error);
+
 	TRACE_RESUME(error);
 	return error;
 }
@@ -461,6 +731,7 @@ void dpm_resume_noirq(pm_message_t state)
 {
 	ktime_t starttime = ktime_get();
 
+	dpm_timing_begin(DPM_PHASE_RESUME_NOIRQ);
 	mutex_lock(&dpm_list_mtx);
 	while (!list_empty(&dpm_noirq_list)) {
 		struct device *dev = to_device(dpm_noirq_list.next);
@@ -478,6 +749,7 @@ void dpm_resume_noirq(pm_message_t state)
 		put_device(dev);
 	}
 	mutex_unlock(&dpm_list_mtx);
+	dpm_timing_end(DPM_PHASE_RESUME_NOIRQ);
 	dpm_show_time(starttime, state, "early");
 	resume_device_irqs();
 }
@@ -511,12 +783,15 @@ static int legacy_resume(struct device *dev, int (*cb)(struct device *dev))
  */
 static int device_resume(struct device *dev, pm_message_t state, bool async)
 {
+	ktime_t enter = ktime_get(), start;
 	int error = 0;
 
 	TRACE_DEVICE(dev);
 	TRACE_RESUME(0);
 
 	dpm_wait(dev->parent, async);
+	dpm_wait_for_links(dev, false, async);
+	start = ktime_get();
 	device_lock(dev);
 
 	/*
@@ -564,6 +839,7 @@ static int device_resume(struct device *dev, pm_message_t state, bool async)
 
  End:
 	dev->power.is_suspended = false;
+	dpm_timing_record(dev, DPM_PHASE_RESUME, enter, start, async, error);
 
  Unlock:
 	device_unlock(dev);
@@ -584,12 +860,6 @@ static void async_resume(void *data, async_cookie_t cookie)
 	put_device(dev);
 }
 
-static bool is_async(struct device *dev)
-{
-	return dev->power.async_suspend && pm_async_enabled
-		&& !pm_trace_is_enabled();
-}
-
 /**
  *	dpm_drv_timeout - Driver suspend / resume watchdog handler
  *	@data: struct device which timed out
@@ -628,6 +898,7 @@ void dpm_resume(pm_message_t state)
 
 	might_sleep();
 
+	dpm_timing_begin(DPM_PHASE_RESUME);
 	mutex_lock(&dpm_list_mtx);
 	pm_transition = state;
 	async_error = 0;
@@ -660,6 +931,7 @@ void dpm_resume(pm_message_t state)
 	}
 	mutex_unlock(&dpm_list_mtx);
 	async_synchronize_full();
+	dpm_timing_end(DPM_PHASE_RESUME);
 	dpm_show_time(starttime, state, NULL);
 }
 
@@ -773,31 +1045,27 @@ static pm_message_t resume_event(pm_message_t sleep_state)
  */
 static int device_suspend_noirq(struct device *dev, pm_message_t state)
 {
-	int error;
+	ktime_t enter = ktime_get();
+	int error = 0;
 
 	if (dev->pwr_domain) {
 		pm_dev_dbg(dev, state, "LATE power domain ");
 		error = pm_noirq_op(dev, &dev->pwr_domain->ops, state);
-		if (error)
-			return error;
 	} else if (dev->type && dev->type->pm) {
 		pm_dev_dbg(dev, state, "LATE type ");
 		error = pm_noirq_op(dev, dev->type->pm, state);
-		if (error)
-			return error;
 	} else if (dev->class && dev->class->pm) {
 		pm_dev_dbg(dev, state, "LATE class ");
 		error = pm_noirq_op(dev, dev->class->pm, state);
-		if (error)
-			return error;
 	} else if (dev->bus && dev->bus->pm) {
 		pm_dev_dbg(dev, state, "LATE ");
 		error = pm_noirq_op(dev, dev->bus->pm, state);
-		if (error)
-			return error;
 	}
 
-	return 0;
+	dpm_timing_record(dev, DPM_PHASE_SUSPEND_NOIRQ, enter, enter, false,
+			  error);
+
+	return error;
 }
 
 /**
@@ -812,6 +1080,7 @@ int dpm_suspend_noirq(pm_message_t state)
 	ktime_t starttime = ktime_get();
 	int error = 0;
 
+	dpm_timing_begin(DPM_PHASE_SUSPEND_NOIRQ);
 	suspend_device_irqs();
 	mutex_lock(&dpm_list_mtx);
 	while (!list_empty(&dpm_suspended_list)) {
@@ -833,6 +1102,7 @@ int dpm_suspend_noirq(pm_message_t state)
 		put_device(dev);
 	}
 	mutex_unlock(&dpm_list_mtx);
+	dpm_timing_end(DPM_PHASE_SUSPEND_NOIRQ);
 	if (error)
 		dpm_resume_noirq(resume_event(state));
 	else
@@ -874,8 +1144,11 @@ static int __device_suspend(struct device *dev, pm_message_t state, bool async)
 	int error = 0;
 	struct timer_list timer;
 	struct dpm_drv_wd_data data;
+	ktime_t enter = ktime_get(), start;
 
 	dpm_wait_for_children(dev, async);
+	dpm_wait_for_links(dev, true, async);
+	start = ktime_get();
 
 	data.dev = dev;
 	data.tsk = get_current();
@@ -931,6 +1204,7 @@ static int __device_suspend(struct device *dev, pm_message_t state, bool async)
 
  End:
 	dev->power.is_suspended = !error;
+	dpm_timing_record(dev, DPM_PHASE_SUSPEND, enter, start, async, error);
 
  Unlock:
 	device_unlock(dev);
@@ -982,6 +1256,7 @@ int dpm_suspend(pm_message_t state)
 
 	might_sleep();
 
+	dpm_timing_begin(DPM_PHASE_SUSPEND);
 	mutex_lock(&dpm_list_mtx);
 	pm_transition = state;
 	async_error = 0;
@@ -1007,6 +1282,7 @@ int dpm_suspend(pm_message_t state)
 	}
 	mutex_unlock(&dpm_list_mtx);
 	async_synchronize_full();
+	dpm_timing_end(DPM_PHASE_SUSPEND);
 	if (!error)
 		error = async_error;
 	if (!error)
@@ -1143,7 +1419,7 @@ EXPORT_SYMBOL_GPL(__suspend_report_result);
  */
 int device_pm_wait_for_dev(struct device *subordinate, struct device *dev)
 {
-	dpm_wait(dev, subordinate->power.async_suspend);
+	dpm_wait(dev, is_async(subordinate));
 	return async_error;
 }
 EXPORT_SYMBOL_GPL(device_pm_wait_for_dev);
@@ -30,6 +30,33 @@ extern void device_pm_move_before(struct device *, struct device *);
 extern void device_pm_move_after(struct device *, struct device *);
 extern void device_pm_move_last(struct device *);
 
+enum dpm_phase {
+	DPM_PHASE_SUSPEND,
+	DPM_PHASE_SUSPEND_NOIRQ,
+	DPM_PHASE_RESUME_NOIRQ,
+	DPM_PHASE_RESUME,
+	DPM_PHASE_COUNT
+};
+
+#ifdef CONFIG_PM_SLEEP_TIMING
+
+/* drivers/base/power/timing.c */
+extern void dpm_timing_begin(enum dpm_phase phase);
+extern void dpm_timing_end(enum dpm_phase phase);
+extern void dpm_timing_record(struct device *dev, enum dpm_phase phase,
+			      ktime_t enter, ktime_t start, bool async,
+			      int error);
+
+#else /* !CONFIG_PM_SLEEP_TIMING */
+
+static inline void dpm_timing_begin(enum dpm_phase phase) {}
+static inline void dpm_timing_end(enum dpm_phase phase) {}
+static inline void dpm_timing_record(struct device *dev, enum dpm_phase phase,
+				     ktime_t enter, ktime_t start, bool async,
+				     int error) {}
+
+#endif /* !CONFIG_PM_SLEEP_TIMING */
+
 #else /* !CONFIG_PM_SLEEP */
 
 static inline void device_pm_init(struct device *dev)
@@ -0,0 +1,251 @@
+/*
+ * drivers/base/power/test_devices.c - Dummy devices for testing device PM.
+ *
+ * This file is released under the GPLv2
+ *
+ * Registers a binary tree of platform devices whose suspend and resume
+ * callbacks sleep for a random time, so that the PM core and the timing
+ * log can be exercised without real hardware, e.g. under QEMU:
+ *
+ *	modprobe test_devices nr_devices=64 max_delay_ms=10 async=1
+ *	echo devices > /sys/power/pm_test
+ *	echo mem > /sys/power/state
+ *	cat /sys/kernel/debug/pm_timing/resume_critical_path
+ *	cat /sys/module/test_devices/parameters/violations
+ *
+ * With the "devices" test level the system stays up: devices are suspended
+ * and resumed again after a few seconds, without platform suspend.
+ *
+ * Devices in the left subtree of the root are made consumers of their
+ * mirror image in the right subtree with device_pm_add_supplier(), before
+ * either is registered. Every callback checks that the parent and the
+ * supplier are still active on suspend and already active on resume, and
+ * the children and consumers the other way around. Each ordering violation
+ * is logged and counted; running many cycles with and without async=1 and
+ * pm_async_resume_all is the ordering stress test.
+ */
+
+#include <linux/delay.h>
+#include <linux/device.h>
+#include <linux/init.h>
+#include <linux/log2.h>
+#include <linux/module.h>
+#include <linux/platform_device.h>
+#include <linux/pm.h>
+#include <linux/random.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+
+#define DRV_NAME	"pm_test_dev"
+
+static unsigned int nr_devices = 32;
+module_param(nr_devices, uint, 0444);
+MODULE_PARM_DESC(nr_devices, "Number of dummy devices");
+
+static unsigned int max_delay_ms = 5;
+module_param(max_delay_ms, uint, 0644);
+MODULE_PARM_DESC(max_delay_ms, "Upper bound of the callback delays");
+
+static bool async;
+module_param(async, bool, 0444);
+MODULE_PARM_DESC(async, "Make every other device suspend and resume "
+		 "asynchronously");
+
+static bool links = true;
+module_param(links, bool, 0444);
+MODULE_PARM_DESC(links, "Add supplier links across the device tree");
+
+static unsigned int violations;
+module_param(violations, uint, 0444);
+MODULE_PARM_DESC(violations, "Number of suspend/resume ordering violations");
+
+struct pm_test_dev {
+	struct platform_device	*pdev;
+	int			supplier;	/* index, or -1 */
+	bool			suspended;
+	bool			added;
+};
+
+static struct pm_test_dev *pm_test_devs;
+static DEFINE_SPINLOCK(pm_test_lock);
+
+/* Mirror image of @i in the right subtree, or -1 if not in the left one */
+static int pm_test_mirror(unsigned int i)
+{
+	unsigned int level, half;
+
+	if (!i)
+		return -1;
+	level = ilog2(i + 1);
+	half = 1 << (level - 1);
+	if (i + 1 - (1 << level) >= half || i + half >= nr_devices)
+		return -1;
+	return i + half;
+}
+
+static void pm_test_delay(void)
+{
+	unsigned int max = ACCESS_ONCE(max_delay_ms);
+
+	if (max)
+		msleep(random32() % (max + 1));
+}
+
+/* @other has to be in state @suspended when @i runs its callback */
+static void pm_test_check(int i, int other, bool suspended, const char *what)
+{
+	if (other < 0 || other >= nr_devices)
+		return;
+	if (pm_test_devs[other].suspended == suspended)
+		return;
+
+	dev_err(&pm_test_devs[i].pdev->dev, "%s %s is %s\n", what,
+		dev_name(&pm_test_devs[other].pdev->dev),
+		suspended ? "active" : "suspended");
+	violations++;
+}
+
+static int pm_test_index(struct device *dev)
+{
+	return to_platform_device(dev)->id;
+}
+
+static int pm_test_suspend(struct device *dev)
+{
+	int i = pm_test_index(dev), j;
+
+	pm_test_delay();
+
+	spin_lock(&pm_test_lock);
+	pm_test_check(i, 2 * i + 1, true, "child");
+	pm_test_check(i, 2 * i + 2, true, "child");
+	for (j = 0; j < nr_devices; j++)
+		if (pm_test_devs[j].supplier == i)
+			pm_test_check(i, j, true, "consumer");
+	if (i)
+		pm_test_check(i, (i - 1) / 2, false, "parent");
+	pm_test_check(i, pm_test_devs[i].supplier, false, "supplier");
+	pm_test_devs[i].suspended = true;
+	spin_unlock(&pm_test_lock);
+	return 0;
+}
+
+static int pm_test_resume(struct device *dev)
+{
+	int i = pm_test_index(dev), j;
+
+	pm_test_delay();
+
+	spin_lock(&pm_test_lock);
+	if (i)
+		pm_test_check(i, (i - 1) / 2, false, "parent");
+	pm_test_check(i, pm_test_devs[i].supplier, false, "supplier");
+	pm_test_check(i, 2 * i + 1, true, "child");
+	pm_test_check(i, 2 * i + 2, true, "child");
+	for (j = 0; j < nr_devices; j++)
+		if (pm_test_devs[j].supplier == i)
+			pm_test_check(i, j, true, "consumer");
+	pm_test_devs[i].suspended = false;
+	spin_unlock(&pm_test_lock);
+	return 0;
+}
+
+static const struct dev_pm_ops pm_test_pm_ops = {
+	.suspend	= pm_test_suspend,
+	.resume		= pm_test_resume,
+};
+
+static struct platform_driver pm_test_driver = {
+	.driver		= {
+		.name	= DRV_NAME,
+		.owner	= THIS_MODULE,
+		.pm	= &pm_test_pm_ops,
+	},
+};
+
+static void pm_test_remove_devices(void)
+{
+	int i;
+
+	for (i = 0; i < nr_devices; i++)
+		if (pm_test_devs[i].pdev && pm_test_devs[i].supplier >= 0)
+			device_pm_remove_supplier(&pm_test_devs[i].pdev->dev,
+				&pm_test_devs[pm_test_devs[i].supplier].pdev->dev);
+
+	/* Children first */
+	for (i = nr_devices - 1; i >= 0; i--) {
+		if (!pm_test_devs[i].pdev)
+			continue;
+		if (pm_test_devs[i].added)
+			platform_device_unregister(pm_test_devs[i].pdev);
+		else
+			platform_device_put(pm_test_devs[i].pdev);
+	}
+}
+
+static int __init pm_test_init(void)
+{
+	struct platform_device *pdev;
+	int i, s, error;
+
+	pm_test_devs = kcalloc(nr_devices, sizeof(*pm_test_devs), GFP_KERNEL);
+	if (!pm_test_devs)
+		return -ENOMEM;
+
+	error = platform_driver_register(&pm_test_driver);
+	if (error)
+		goto err_free;
+
+	for (i = 0; i < nr_devices; i++) {
+		pdev = platform_device_alloc(DRV_NAME, i);
+		if (!pdev) {
+			error = -ENOMEM;
+			goto err_devices;
+		}
+		if (i)
+			pdev->dev.parent = &pm_test_devs[(i - 1) / 2].pdev->dev;
+		if (async && (i & 1))
+			device_enable_async_suspend(&pdev->dev);
+		pm_test_devs[i].pdev = pdev;
+		pm_test_devs[i].supplier = -1;
+	}
+
+	/* Suppliers come later in the tree and are not registered yet */
+	for (i = 0; links && i < nr_devices; i++) {
+		s = pm_test_mirror(i);
+		if (s < 0)
+			continue;
+		error = device_pm_add_supplier(&pm_test_devs[i].pdev->dev,
+					       &pm_test_devs[s].pdev->dev);
+		if (error)
+			goto err_devices;
+		pm_test_devs[i].supplier = s;
+	}
+
+	for (i = 0; i < nr_devices; i++) {
+		error = platform_device_add(pm_test_devs[i].pdev);
+		if (error)
+			goto err_devices;
+		pm_test_devs[i].added = true;
+	}
+	return 0;
+
+ err_devices:
+	pm_test_remove_devices();
+	platform_driver_unregister(&pm_test_driver);
+ err_free:
+	kfree(pm_test_devs);
+	return error;
+}
+module_init(pm_test_init);
+
+static void __exit pm_test_exit(void)
+{
+	pm_test_remove_devices();
+	platform_driver_unregister(&pm_test_driver);
+	kfree(pm_test_devs);
+}
+module_exit(pm_test_exit);
+
+MODULE_DESCRIPTION("Dummy devices for testing device suspend/resume");
+MODULE_LICENSE("GPL");
@@ -0,0 +1,319 @@
+/*
+ * drivers/base/power/timing.c - Per-device suspend/resume latency log.
+ *
+ * This file is released under the GPLv2
+ *
+ * Every device suspend and resume callback executed by the PM core is
+ * recorded in a fixed size ring buffer, together with the time the device
+ * spent waiting for its parent (or children) before the callback could run.
+ * The log of the last transition is available in debugfs as
+ * pm_timing/log, and pm_timing/resume_critical_path reconstructs the chain
+ * of devices that determined how long the last dpm_resume() took.
+ */
+
+#include <linux/debugfs.h>
+#include <linux/device.h>
+#include <linux/hrtimer.h>
+#include <linux/init.h>
+#include <linux/seq_file.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+#include <linux/vmalloc.h>
+
+#include "power.h"
+
+#define DPM_TIMING_ENTRIES	512
+#define DPM_TIMING_NAME_LEN	20
+
+struct dpm_timing_entry {
+	/* Used only to match parents and children, never dereferenced */
+	const struct device	*dev;
+	const struct device	*parent;
+	char			name[DPM_TIMING_NAME_LEN];
+	unsigned int		cycle;
+	u8			phase;
+	u8			async;
+	short			error;
+	ktime_t			enter;	/* callback requested */
+	ktime_t			start;	/* dependencies satisfied */
+	ktime_t			end;	/* callback returned */
+};
+
+static DEFINE_SPINLOCK(dpm_timing_lock);
+static struct dpm_timing_entry dpm_timing_log[DPM_TIMING_ENTRIES];
+static unsigned int dpm_timing_head;
+static unsigned int dpm_timing_count;
+static unsigned int dpm_timing_seq;
+static unsigned int dpm_timing_cycle[DPM_PHASE_COUNT];
+static ktime_t dpm_timing_phase_start[DPM_PHASE_COUNT];
+static ktime_t dpm_timing_phase_end[DPM_PHASE_COUNT];
+
+static const char * const dpm_phase_names[DPM_PHASE_COUNT] = {
+	[DPM_PHASE_SUSPEND]		= "suspend",
+	[DPM_PHASE_SUSPEND_NOIRQ]	= "suspend_noirq",
+	[DPM_PHASE_RESUME_NOIRQ]	= "resume_noirq",
+	[DPM_PHASE_RESUME]		= "resume",
+};
+
+/**
+ * dpm_timing_begin - Mark the start of a device PM phase.
+ * @phase: Phase about to be executed.
+ */
+void dpm_timing_begin(enum dpm_phase phase)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&dpm_timing_lock, flags);
+	dpm_timing_cycle[phase] = ++dpm_timing_seq;
+	dpm_timing_phase_start[phase] = ktime_get();
+	dpm_timing_phase_end[phase] = ktime_set(0, 0);
+	spin_unlock_irqrestore(&dpm_timing_lock, flags);
+}
+
+/**
+ * dpm_timing_end - Mark the end of a device PM phase.
+ * @phase: Phase that has just completed.
+ */
+void dpm_timing_end(enum dpm_phase phase)
+{
+	ktime_t end = ktime_get();
+	unsigned long flags;
+
+	spin_lock_irqsave(&dpm_timing_lock, flags);
+	dpm_timing_phase_end[phase] = end;
+	spin_unlock_irqrestore(&dpm_timing_lock, flags);
+}
+
+/**
+ * dpm_timing_record - Log one device callback.
+ * @dev: Device the callback was executed for.
+ * @phase: Phase the callback belongs to.
+ * @enter: Time the PM core started handling @dev.
+ * @start: Time the callback was invoked, after waiting for dependencies.
+ * @async: Whether @dev was handled asynchronously.
+ * @error: Callback return value.
+ */
+void dpm_timing_record(struct device *dev, enum dpm_phase phase,
+		       ktime_t enter, ktime_t start, bool async, int error)
+{
+	struct dpm_timing_entry *e;
+	unsigned long flags;
+	ktime_t end = ktime_get();
+
+	spin_lock_irqsave(&dpm_timing_lock, flags);
+	e = &dpm_timing_log[dpm_timing_head];
+	dpm_timing_head = (dpm_timing_head + 1) % DPM_TIMING_ENTRIES;
+	if (dpm_timing_count < DPM_TIMING_ENTRIES)
+		dpm_timing_count++;
+
+	e->dev = dev;
+	e->parent = dev->parent;
+	strlcpy(e->name, dev_name(dev), sizeof(e->name));
+	e->cycle = dpm_timing_cycle[phase];
+	e->phase = phase;
+	e->async = async;
+	e->error = error;
+	e->enter = enter;
+	e->start = start;
+	e->end = end;
+	spin_unlock_irqrestore(&dpm_timing_lock, flags);
+}
+
+#ifdef CONFIG_DEBUG_FS
+
+/*
+ * The debugfs files work on a copy of the entries of the last cycle of
+ * each phase, taken with the lock held and interrupts off, so that walking
+ * and formatting the log don't delay the PM core or interrupts.
+ */
+struct dpm_timing_snapshot {
+	unsigned int		count;
+	ktime_t			phase_start[DPM_PHASE_COUNT];
+	ktime_t			phase_end[DPM_PHASE_COUNT];
+	struct dpm_timing_entry	log[DPM_TIMING_ENTRIES];
+};
+
+/* Oldest entries first */
+static struct dpm_timing_snapshot *dpm_timing_snapshot(void)
+{
+	struct dpm_timing_snapshot *snap;
+	struct dpm_timing_entry *e;
+	unsigned int i;
+
+	snap = vmalloc(sizeof(*snap));
+	if (!snap)
+		return NULL;
+
+	snap->count = 0;
+	spin_lock_irq(&dpm_timing_lock);
+	memcpy(snap->phase_start, dpm_timing_phase_start,
+	       sizeof(snap->phase_start));
+	memcpy(snap->phase_end, dpm_timing_phase_end, sizeof(snap->phase_end));
+	for (i = 0; i < dpm_timing_count; i++) {
+		e = &dpm_timing_log[(dpm_timing_head + DPM_TIMING_ENTRIES -
+				     dpm_timing_count + i) % DPM_TIMING_ENTRIES];
+		if (e->cycle == dpm_timing_cycle[e->phase])
+			snap->log[snap->count++] = *e;
+	}
+	spin_unlock_irq(&dpm_timing_lock);
+	return snap;
+}
+
+static s64 dpm_timing_us(ktime_t from, ktime_t to)
+{
+	return ktime_to_us(ktime_sub(to, from));
+}
+
+static int dpm_timing_log_show(struct seq_file *s, void *data)
+{
+	struct dpm_timing_snapshot *snap;
+	struct dpm_timing_entry *e;
+	unsigned int i;
+
+	snap = dpm_timing_snapshot();
+	if (!snap)
+		return -ENOMEM;
+
+	seq_printf(s, "%-13s %10s %10s %10s %-5s %5s  %s\n", "phase",
+		   "offset_us", "wait_us", "call_us", "mode", "err", "device");
+
+	for (i = 0; i < snap->count; i++) {
+		e = &snap->log[i];
+		seq_printf(s, "%-13s %10lld %10lld %10lld %-5s %5d  %s\n",
+			   dpm_phase_names[e->phase],
+			   dpm_timing_us(snap->phase_start[e->phase], e->enter),
+			   dpm_timing_us(e->enter, e->start),
+			   dpm_timing_us(e->start, e->end),
+			   e->async ? "async" : "sync", e->error, e->name);
+	}
+	vfree(snap);
+	return 0;
+}
+
+/* Last entry of @phase matching @dev, or NULL */
+static struct dpm_timing_entry *dpm_timing_find(
+	struct dpm_timing_snapshot *snap, enum dpm_phase phase,
+	const struct device *dev)
+{
+	struct dpm_timing_entry *e, *found = NULL;
+
+	for (e = snap->log; e < snap->log + snap->count; e++)
+		if (e->phase == phase && e->dev == dev)
+			found = e;
+	return found;
+}
+
+/*
+ * Find the synchronous entry that the main resume thread completed last
+ * before it got to @next, i.e. the serial predecessor of @next.
+ */
+static struct dpm_timing_entry *dpm_timing_find_prev_sync(
+	struct dpm_timing_snapshot *snap, enum dpm_phase phase,
+	struct dpm_timing_entry *next)
+{
+	struct dpm_timing_entry *e, *found = NULL;
+
+	for (e = snap->log; e < next; e++)
+		if (e->phase == phase && !e->async &&
+		    ktime_to_ns(e->end) <= ktime_to_ns(next->enter))
+			found = e;
+	return found;
+}
+
+/*
+ * Walk backwards from the device that finished last. A device that had to
+ * wait for its parent is gated by the parent; a synchronous device that did
+ * not wait is gated by the previous synchronous device; an asynchronous
+ * device that did not wait started as soon as the phase began.
+ */
+static int dpm_timing_critical_path_show(struct seq_file *s, void *data)
+{
+	const enum dpm_phase phase = DPM_PHASE_RESUME;
+	struct dpm_timing_snapshot *snap;
+	struct dpm_timing_entry *e, *tail = NULL;
+	ktime_t base, end;
+	unsigned int steps = 0;
+
+	snap = dpm_timing_snapshot();
+	if (!snap)
+		return -ENOMEM;
+
+	base = snap->phase_start[phase];
+	end = snap->phase_end[phase];
+	for (e = snap->log; e < snap->log + snap->count; e++)
+		if (e->phase == phase &&
+		    (!tail || ktime_to_ns(e->end) > ktime_to_ns(tail->end)))
+			tail = e;
+
+	if (!tail) {
+		seq_printf(s, "no resume recorded\n");
+		goto out;
+	}
+
+	seq_printf(s, "resume took %lld us, last device done at %lld us\n",
+		   ktime_to_ns(end) ? dpm_timing_us(base, end) : -1LL,
+		   dpm_timing_us(base, tail->end));
+	seq_printf(s, "%10s %10s %10s %-5s  %s\n",
+		   "start_us", "wait_us", "call_us", "mode", "device");
+
+	for (e = tail; e && steps < DPM_TIMING_ENTRIES; steps++) {
+		s64 wait = dpm_timing_us(e->enter, e->start);
+
+		seq_printf(s, "%10lld %10lld %10lld %-5s  %s\n",
+			   dpm_timing_us(base, e->start), wait,
+			   dpm_timing_us(e->start, e->end),
+			   e->async ? "async" : "sync", e->name);
+
+		if (wait > 0 && e->parent)
+			e = dpm_timing_find(snap, phase, e->parent);
+		else if (!e->async)
+			e = dpm_timing_find_prev_sync(snap, phase, e);
+		else
+			e = NULL;
+	}
+ out:
+	vfree(snap);
+	return 0;
+}
+
+static int dpm_timing_log_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, dpm_timing_log_show, NULL);
+}
+
+static int dpm_timing_critical_path_open(struct inode *inode,
+					 struct file *file)
+{
+	return single_open(file, dpm_timing_critical_path_show, NULL);
+}
+
+static const struct file_operations dpm_timing_log_fops = {
+	.open		= dpm_timing_log_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static const struct file_operations dpm_timing_critical_path_fops = {
+	.open		= dpm_timing_critical_path_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init dpm_timing_debug_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("pm_timing", NULL);
+	if (!dir)
+		return -ENOMEM;
+
+	debugfs_create_file("log", 0444, dir, NULL, &dpm_timing_log_fops);
+	debugfs_create_file("resume_critical_path", 0444, dir, NULL,
+			    &dpm_timing_critical_path_fops);
+	return 0;
+}
+
+late_initcall(dpm_timing_debug_init);
+#endif /* CONFIG_DEBUG_FS */
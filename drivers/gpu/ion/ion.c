@@ -29,6 +29,7 @@
 #include <linux/seq_file.h>
 #include <linux/uaccess.h>
 #include <linux/debugfs.h>
+#include <linux/mman.h>
 
 #include "ion_priv.h"
 #include "../pvr/ion.h"
@@ -801,6 +802,8 @@ static void ion_vma_open(struct vm_area_struct *vma)
 	struct ion_client *client;
 
 	pr_debug("%s: %d\n", __func__, __LINE__);
+	if (buffer->heap->ops->vma_open)
+		buffer->heap->ops->vma_open(buffer->heap, buffer, vma);
 	/* check that the client still exists and take a reference so
 	   it can't go away until this vma is closed */
 	client = ion_client_lookup(buffer->dev, current->group_leader);
@@ -916,6 +919,40 @@ err:
 	return ret;
 }
 
+/*
+ * Place mappings of physically contiguous buffers at the same offset
+ * into a 64K block as the memory, so that the heap can use large pages.
+ */
+#define ION_MAP_ALIGN	(64 * 1024)
+
+static unsigned long ion_share_get_unmapped_area(struct file *file,
+						 unsigned long addr,
+						 unsigned long len,
+						 unsigned long pgoff,
+						 unsigned long flags)
+{
+	struct ion_buffer *buffer = file->private_data;
+	ion_phys_addr_t paddr;
+	unsigned long area, off;
+	size_t size;
+
+	if ((flags & MAP_FIXED) || len < ION_MAP_ALIGN ||
+	    !buffer->heap->ops->phys ||
+	    buffer->heap->ops->phys(buffer->heap, buffer, &paddr, &size))
+		return current->mm->get_unmapped_area(file, addr, len, pgoff,
+						      flags);
+
+	area = current->mm->get_unmapped_area(file, addr,
+					      len + ION_MAP_ALIGN - PAGE_SIZE,
+					      pgoff, flags);
+	if (IS_ERR_VALUE(area))
+		return current->mm->get_unmapped_area(file, addr, len, pgoff,
+						      flags);
+
+	off = paddr + (pgoff << PAGE_SHIFT);
+	return area + ((off - area) & (ION_MAP_ALIGN - 1));
+}
+
 static int ion_map_gralloc(struct ion_client *client, void *grallocHandle,
 			   struct ion_handle **handleY)
 {
@@ -933,6 +970,7 @@ static const struct file_operations ion_share_fops = {
 	.owner		= THIS_MODULE,
 	.release	= ion_share_release,
 	.mmap		= ion_share_mmap,
+	.get_unmapped_area = ion_share_get_unmapped_area,
 };
 
 static int ion_ioctl_share(struct file *parent, struct ion_client *client,
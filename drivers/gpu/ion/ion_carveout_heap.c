@@ -19,13 +19,24 @@
 #include <linux/genalloc.h>
 #include <linux/io.h>
 #include <linux/ion.h>
+#include <linux/log2.h>
 #include <linux/mm.h>
+#include <linux/pfn.h>
 #include <linux/scatterlist.h>
 #include <linux/slab.h>
 #include <linux/vmalloc.h>
 #include "ion_priv.h"
 
+#ifdef CONFIG_ARM
 #include <asm/mach/map.h>
+#endif
+
+/* Buffers of this size or more are aligned for large page mappings */
+#ifdef LARGE_PAGE_SIZE
+#define ION_CARVEOUT_ALIGN	LARGE_PAGE_SIZE
+#else
+#define ION_CARVEOUT_ALIGN	PAGE_SIZE
+#endif
 
 struct ion_carveout_heap {
 	struct ion_heap heap;
@@ -39,8 +50,35 @@ ion_phys_addr_t ion_carveout_allocate(struct ion_heap *heap,
 {
 	struct ion_carveout_heap *carveout_heap =
 		container_of(heap, struct ion_carveout_heap, heap);
-	unsigned long offset = gen_pool_alloc(carveout_heap->pool, size);
+	unsigned long offset, start;
+
+	/* The length comes from userspace, the trimming below needs pages */
+	size = PAGE_ALIGN(size);
+
+	/*
+	 * Align large buffers, so that they can be mapped with large pages.
+	 * The pool has no aligned allocator: allocate enough to find an
+	 * aligned block and give back what lies around it.
+	 */
+	if (size >= ION_CARVEOUT_ALIGN && align < ION_CARVEOUT_ALIGN)
+		align = ION_CARVEOUT_ALIGN;
+	if (align > PAGE_SIZE && is_power_of_2(align)) {
+		offset = gen_pool_alloc(carveout_heap->pool,
+					size + align - PAGE_SIZE);
+		if (offset) {
+			start = ALIGN(offset, align);
+			if (start != offset)
+				gen_pool_free(carveout_heap->pool, offset,
+					      start - offset);
+			if (start - offset != align - PAGE_SIZE)
+				gen_pool_free(carveout_heap->pool, start + size,
+					      align - PAGE_SIZE -
+					      (start - offset));
+			return start;
+		}
+	}
 
+	offset = gen_pool_alloc(carveout_heap->pool, size);
 	if (!offset)
 		return ION_CARVEOUT_ALLOCATE_FAIL;
 
@@ -99,14 +137,22 @@ void ion_carveout_heap_unmap_dma(struct ion_heap *heap,
 void *ion_carveout_heap_map_kernel(struct ion_heap *heap,
 				   struct ion_buffer *buffer)
 {
+#ifdef CONFIG_ARM
 	return __arch_ioremap(buffer->priv_phys, buffer->size,
 			      MT_MEMORY_NONCACHED);
+#else
+	return ioremap_nocache(buffer->priv_phys, buffer->size);
+#endif
 }
 
 void ion_carveout_heap_unmap_kernel(struct ion_heap *heap,
 				    struct ion_buffer *buffer)
 {
+#ifdef CONFIG_ARM
 	__arch_iounmap(buffer->vaddr);
+#else
+	iounmap(buffer->vaddr);
+#endif
 	buffer->vaddr = NULL;
 	return;
 }
@@ -114,10 +160,17 @@ void ion_carveout_heap_unmap_kernel(struct ion_heap *heap,
 int ion_carveout_heap_map_user(struct ion_heap *heap, struct ion_buffer *buffer,
 			       struct vm_area_struct *vma)
 {
-	return remap_pfn_range(vma, vma->vm_start,
-			       __phys_to_pfn(buffer->priv_phys) + vma->vm_pgoff,
-			       buffer->size,
-			       pgprot_noncached(vma->vm_page_prot));
+	return remap_pfn_range_large(vma, vma->vm_start,
+			PFN_DOWN(buffer->priv_phys) + vma->vm_pgoff,
+			vma->vm_end - vma->vm_start,
+			pgprot_noncached(vma->vm_page_prot));
+}
+
+void ion_carveout_heap_vma_open(struct ion_heap *heap,
+				struct ion_buffer *buffer,
+				struct vm_area_struct *vma)
+{
+	split_large_pages(vma);
 }
 
 static struct ion_heap_ops carveout_heap_ops = {
@@ -125,6 +178,7 @@ static struct ion_heap_ops carveout_heap_ops = {
 	.free = ion_carveout_heap_free,
 	.phys = ion_carveout_heap_phys,
 	.map_user = ion_carveout_heap_map_user,
+	.vma_open = ion_carveout_heap_vma_open,
 	.map_kernel = ion_carveout_heap_map_kernel,
 	.unmap_kernel = ion_carveout_heap_unmap_kernel,
 };
@@ -186,6 +186,8 @@ int inode_init_always(struct super_block *sb, struct inode *inode)
 	mapping->assoc_mapping = NULL;
 	mapping->backing_dev_info = &default_backing_dev_info;
 	mapping->writeback_index = 0;
+	/* Shadows of a previous inode at this address must not match */
+	mapping->shadow_gen = 0;
 
 	/*
 	 * If the block_device provides a backing_dev_info for client
@@ -729,7 +729,8 @@ static struct file *__dentry_open(struct dentry *dentry, struct vfsmount *mnt,
 			fput(f);
 			f = ERR_PTR(-EINVAL);
 		}
-	}
+	} else if (f->f_mapping->a_ops)
+		ra_pattern_open(f);
 
 	return f;
 
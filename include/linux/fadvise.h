@@ -18,4 +18,8 @@
 #define POSIX_FADV_NOREUSE	5 /* Data will be accessed once.  */
 #endif
 
+/* Linux specific: record and replay the readahead pattern of a file */
+#define POSIX_FADV_RA_RECORD	8 /* Record accesses until close.  */
+#define POSIX_FADV_RA_REPLAY	9 /* Read ahead the recorded pattern.  */
+
 #endif	/* FADVISE_H_INCLUDED */
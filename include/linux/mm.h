@@ -1490,6 +1490,12 @@ void page_cache_async_readahead(struct address_space *mapping,
 				unsigned long size);
 
 unsigned long max_sane_readahead(unsigned long nr);
+
+/* ra_pattern.c */
+void ra_pattern_record(struct file *file, pgoff_t index);
+int ra_pattern_start_record(struct file *file);
+int ra_pattern_replay(struct file *file, bool force);
+void ra_pattern_open(struct file *file);
 unsigned long ra_submit(struct file_ra_state *ra,
 			struct address_space *mapping,
 			struct file *filp);
@@ -1546,6 +1552,25 @@ int vm_insert_mixed(struct vm_area_struct *vma, unsigned long addr,
 			unsigned long pfn);
 int vm_iomap_memory(struct vm_area_struct *vma, phys_addr_t start, unsigned long len);
 
+#ifndef __HAVE_ARCH_REMAP_PFN_RANGE_LARGE
+/* Architectures without large page mappings of PFN ranges */
+static inline int remap_pfn_range_large(struct vm_area_struct *vma,
+		unsigned long addr, unsigned long pfn, unsigned long size,
+		pgprot_t prot)
+{
+	return remap_pfn_range(vma, addr, pfn, size, prot);
+}
+
+static inline void split_large_pages(struct vm_area_struct *vma)
+{
+}
+
+static inline void split_large_pages_range(struct vm_area_struct *vma,
+		unsigned long start, unsigned long end)
+{
+}
+#endif
+
 
 struct page *follow_page(struct vm_area_struct *, unsigned long address,
 			unsigned int foll_flags);
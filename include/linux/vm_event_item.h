@@ -22,9 +22,12 @@
 #define FOR_ALL_ZONES(xx) DMA_ZONE(xx) DMA32_ZONE(xx) xx##_NORMAL HIGHMEM_ZONE(xx) , xx##_MOVABLE
 
 enum vm_event_item { PGPGIN, PGPGOUT, PSWPIN, PSWPOUT,
+		PSWPOUT_BATCHED, PSWPOUT_SINGLE, SWAP_SLOTS_REFILL,
 		FOR_ALL_ZONES(PGALLOC),
 		PGFREE, PGACTIVATE, PGDEACTIVATE,
+		PCP_HIGH_ORDER_HIT, PCP_HIGH_ORDER_MISS,
 		PGFAULT, PGMAJFAULT,
+		WORKINGSET_REFAULT, WORKINGSET_ACTIVATE,
 		FOR_ALL_ZONES(PGREFILL),
 		FOR_ALL_ZONES(PGSTEAL),
 		FOR_ALL_ZONES(PGSCAN_KSWAPD),
@@ -40,6 +43,8 @@ enum vm_event_item { PGPGIN, PGPGOUT, PSWPIN, PSWPOUT,
 		COMPACTBLOCKS, COMPACTPAGES, COMPACTPAGEFAILED,
 		COMPACTSTALL, COMPACTFAIL, COMPACTSUCCESS,
 		COMPACTSUCCESS_RETRY,
+		COMPACTDIRECTPAGES,
+		KCOMPACTD_WAKE, COMPACTPROACTIVE, COMPACTPROACTIVEPAGES,
 #endif
 #ifdef CONFIG_HUGETLB_PAGE
 		HTLB_BUDDY_PGALLOC, HTLB_BUDDY_PGALLOC_FAIL,
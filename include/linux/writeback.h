@@ -43,6 +43,13 @@ struct writeback_control {
 	loff_t range_start;
 	loff_t range_end;
 
+	/*
+	 * For swap_writepage() from reclaim: if non-NULL, contiguous swap
+	 * pages are gathered in *swap_plug and the caller submits it with
+	 * swap_write_unplug().
+	 */
+	struct bio **swap_plug;
+
 	unsigned nonblocking:1;		/* Don't get stuck on request queues */
 	unsigned encountered_congestion:1; /* An output: a queue is full */
 	unsigned for_kupdate:1;		/* A kupdate writeback */
@@ -0,0 +1,434 @@
+/*
+ * Continuous stack sampling profiler
+ *
+ * A CPU cycles (or cpu-clock) perf event is opened on every online CPU.
+ * Its overflow handler records the kernel and user callchain of the
+ * interrupted task into a per-CPU ring, using the same arch callchain
+ * walkers as perf. A work item drains the rings every 100ms and counts
+ * identical stacks in a fixed size table, so memory use is bounded no
+ * matter how long profiling runs. Stacks that do not fit in the table
+ * are only counted as dropped.
+ *
+ * Control and output are in debugfs, under stackprof/:
+ *
+ *   enable	1 starts sampling, 0 stops it
+ *   frequency	samples per second and CPU, used by the next start
+ *   use_clock	1 samples on the cpu-clock software event rather than on
+ *		CPU cycles, e.g. when no PMU is available
+ *   stacks	one line per stack, "comm;outermost;...;innermost count",
+ *		as expected by flame graph tools; writing to it clears
+ *		the table
+ *   stats	sample, loss and table usage counters
+ *
+ * This file is released under the GPLv2.
+ */
+
+#include <linux/debugfs.h>
+#include <linux/init.h>
+#include <linux/jhash.h>
+#include <linux/kernel.h>
+#include <linux/mutex.h>
+#include <linux/perf_event.h>
+#include <linux/sched.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+#include <linux/workqueue.h>
+
+#define STACKPROF_DEPTH		32
+#define STACKPROF_RING_SIZE	128	/* samples per CPU, power of two */
+#define STACKPROF_ENTRIES	1024	/* distinct stacks, power of two */
+#define STACKPROF_DRAIN_MS	100
+
+struct stackprof_stack {
+	u32		hash;
+	u8		nr;		/* entries used in ip[] */
+	u8		nr_kernel;	/* of which kernel addresses */
+	char		comm[TASK_COMM_LEN];
+	unsigned long	ip[STACKPROF_DEPTH];	/* innermost first */
+};
+
+struct stackprof_entry {
+	unsigned long		count;	/* 0 if unused */
+	struct stackprof_stack	stack;
+};
+
+struct stackprof_cpu {
+	spinlock_t			lock;
+	unsigned int			head;
+	unsigned int			tail;
+	unsigned long			lost;
+	struct perf_event		*event;
+	struct perf_callchain_entry	callchain;
+	struct stackprof_stack		ring[STACKPROF_RING_SIZE];
+};
+
+static DEFINE_MUTEX(stackprof_mutex);
+static struct stackprof_cpu *stackprof_cpus;
+static struct stackprof_entry *stackprof_table;
+static bool stackprof_enabled;
+static u32 stackprof_frequency = 100;
+static u32 stackprof_use_clock;
+static unsigned long stackprof_samples;
+static unsigned long stackprof_dropped;
+static unsigned int stackprof_used;
+
+static void stackprof_drain_work(struct work_struct *work);
+static DECLARE_DELAYED_WORK(stackprof_drain, stackprof_drain_work);
+
+/* Copy the usable part of a perf callchain, skipping context markers */
+static void stackprof_copy(struct stackprof_stack *stack,
+			   struct perf_callchain_entry *entry)
+{
+	bool kernel = false;
+	unsigned int i;
+
+	stack->nr = 0;
+	stack->nr_kernel = 0;
+	for (i = 0; i < entry->nr && stack->nr < STACKPROF_DEPTH; i++) {
+		u64 ip = entry->ip[i];
+
+		if (ip >= PERF_CONTEXT_MAX) {
+			kernel = ip == PERF_CONTEXT_KERNEL;
+			continue;
+		}
+		stack->ip[stack->nr++] = ip;
+		if (kernel)
+			stack->nr_kernel++;
+	}
+}
+
+static void stackprof_overflow(struct perf_event *event, int nmi,
+			       struct perf_sample_data *data,
+			       struct pt_regs *regs)
+{
+	struct stackprof_cpu *pc = &stackprof_cpus[smp_processor_id()];
+	struct perf_callchain_entry *entry = &pc->callchain;
+	struct stackprof_stack *stack;
+
+	entry->nr = 0;
+	if (!user_mode(regs)) {
+		perf_callchain_store(entry, PERF_CONTEXT_KERNEL);
+		perf_callchain_kernel(entry, regs);
+		regs = current->mm ? task_pt_regs(current) : NULL;
+	}
+	if (regs) {
+		perf_callchain_store(entry, PERF_CONTEXT_USER);
+		perf_callchain_user(entry, regs);
+	}
+
+	spin_lock(&pc->lock);
+	if (pc->head - pc->tail >= STACKPROF_RING_SIZE) {
+		pc->lost++;
+	} else {
+		stack = &pc->ring[pc->head & (STACKPROF_RING_SIZE - 1)];
+		stackprof_copy(stack, entry);
+		memcpy(stack->comm, current->group_leader->comm,
+		       sizeof(stack->comm));
+		pc->head++;
+	}
+	spin_unlock(&pc->lock);
+}
+
+static bool stackprof_same(const struct stackprof_stack *a,
+			   const struct stackprof_stack *b)
+{
+	return a->hash == b->hash && a->nr == b->nr &&
+	       a->nr_kernel == b->nr_kernel &&
+	       !memcmp(a->ip, b->ip, a->nr * sizeof(a->ip[0])) &&
+	       !strncmp(a->comm, b->comm, sizeof(a->comm));
+}
+
+/* Count @stack in the table. Called with stackprof_mutex held. */
+static void stackprof_account(struct stackprof_stack *stack)
+{
+	struct stackprof_entry *e;
+	unsigned int i, slot;
+
+	stack->comm[sizeof(stack->comm) - 1] = '\0';
+	stack->hash = jhash(stack->ip, stack->nr * sizeof(stack->ip[0]),
+			    jhash(stack->comm, strlen(stack->comm),
+				  stack->nr_kernel));
+	stackprof_samples++;
+
+	slot = stack->hash;
+	for (i = 0; i < STACKPROF_ENTRIES; i++, slot++) {
+		e = &stackprof_table[slot & (STACKPROF_ENTRIES - 1)];
+		if (!e->count) {
+			if (stackprof_used >= STACKPROF_ENTRIES * 3 / 4)
+				break;
+			e->stack = *stack;
+			e->count = 1;
+			stackprof_used++;
+			return;
+		}
+		if (stackprof_same(&e->stack, stack)) {
+			e->count++;
+			return;
+		}
+	}
+	stackprof_dropped++;
+}
+
+/* Move all buffered samples to the table. Called with stackprof_mutex held. */
+static void stackprof_drain_rings(void)
+{
+	struct stackprof_stack stack;
+	unsigned long flags;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct stackprof_cpu *pc = &stackprof_cpus[cpu];
+
+		for (;;) {
+			spin_lock_irqsave(&pc->lock, flags);
+			if (pc->tail == pc->head) {
+				spin_unlock_irqrestore(&pc->lock, flags);
+				break;
+			}
+			stack = pc->ring[pc->tail & (STACKPROF_RING_SIZE - 1)];
+			pc->tail++;
+			spin_unlock_irqrestore(&pc->lock, flags);
+
+			stackprof_account(&stack);
+		}
+	}
+}
+
+static void stackprof_drain_work(struct work_struct *work)
+{
+	mutex_lock(&stackprof_mutex);
+	stackprof_drain_rings();
+	if (stackprof_enabled)
+		schedule_delayed_work(&stackprof_drain,
+				      msecs_to_jiffies(STACKPROF_DRAIN_MS));
+	mutex_unlock(&stackprof_mutex);
+}
+
+static void stackprof_stop(void)
+{
+	int cpu;
+
+	stackprof_enabled = false;
+	for_each_possible_cpu(cpu) {
+		struct stackprof_cpu *pc = &stackprof_cpus[cpu];
+
+		if (pc->event) {
+			perf_event_release_kernel(pc->event);
+			pc->event = NULL;
+		}
+	}
+	stackprof_drain_rings();
+}
+
+static int stackprof_start(void)
+{
+	struct perf_event_attr attr = {
+		.size		= sizeof(struct perf_event_attr),
+		.pinned		= 1,
+		.exclude_idle	= 1,
+		.freq		= 1,
+	};
+	struct perf_event *event;
+	int cpu, ret = 0;
+
+	if (!stackprof_frequency)
+		return -EINVAL;
+
+	if (!stackprof_cpus) {
+		stackprof_cpus = vzalloc(nr_cpu_ids * sizeof(*stackprof_cpus));
+		stackprof_table = vzalloc(STACKPROF_ENTRIES *
+					  sizeof(*stackprof_table));
+		if (!stackprof_cpus || !stackprof_table) {
+			vfree(stackprof_cpus);
+			vfree(stackprof_table);
+			stackprof_cpus = NULL;
+			stackprof_table = NULL;
+			return -ENOMEM;
+		}
+		for_each_possible_cpu(cpu)
+			spin_lock_init(&stackprof_cpus[cpu].lock);
+	}
+
+	if (stackprof_use_clock) {
+		attr.type = PERF_TYPE_SOFTWARE;
+		attr.config = PERF_COUNT_SW_CPU_CLOCK;
+	} else {
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = PERF_COUNT_HW_CPU_CYCLES;
+	}
+	attr.sample_freq = stackprof_frequency;
+
+	get_online_cpus();
+	for_each_online_cpu(cpu) {
+		event = perf_event_create_kernel_counter(&attr, cpu, NULL,
+							 stackprof_overflow);
+		if (IS_ERR(event)) {
+			ret = PTR_ERR(event);
+			break;
+		}
+		stackprof_cpus[cpu].event = event;
+	}
+	put_online_cpus();
+
+	if (ret) {
+		stackprof_stop();
+		return ret;
+	}
+
+	stackprof_enabled = true;
+	schedule_delayed_work(&stackprof_drain,
+			      msecs_to_jiffies(STACKPROF_DRAIN_MS));
+	return 0;
+}
+
+static int stackprof_enable_get(void *data, u64 *val)
+{
+	*val = stackprof_enabled;
+	return 0;
+}
+
+static int stackprof_enable_set(void *data, u64 val)
+{
+	int ret = 0;
+
+	mutex_lock(&stackprof_mutex);
+	if (val && !stackprof_enabled)
+		ret = stackprof_start();
+	else if (!val && stackprof_enabled)
+		stackprof_stop();
+	mutex_unlock(&stackprof_mutex);
+
+	return ret;
+}
+DEFINE_SIMPLE_ATTRIBUTE(stackprof_enable_fops, stackprof_enable_get,
+			stackprof_enable_set, "%llu\n");
+
+static void *stackprof_seq_start(struct seq_file *s, loff_t *pos)
+{
+	mutex_lock(&stackprof_mutex);
+	if (!stackprof_table)
+		return NULL;
+	if (!*pos)
+		stackprof_drain_rings();
+	for (; *pos < STACKPROF_ENTRIES; (*pos)++)
+		if (stackprof_table[*pos].count)
+			return &stackprof_table[*pos];
+	return NULL;
+}
+
+static void *stackprof_seq_next(struct seq_file *s, void *v, loff_t *pos)
+{
+	while (++(*pos) < STACKPROF_ENTRIES)
+		if (stackprof_table[*pos].count)
+			return &stackprof_table[*pos];
+	return NULL;
+}
+
+static void stackprof_seq_stop(struct seq_file *s, void *v)
+{
+	mutex_unlock(&stackprof_mutex);
+}
+
+static int stackprof_seq_show(struct seq_file *s, void *v)
+{
+	struct stackprof_entry *e = v;
+	struct stackprof_stack *stack = &e->stack;
+	int i;
+
+	seq_printf(s, "%s", stack->comm);
+	for (i = stack->nr - 1; i >= stack->nr_kernel; i--)
+		seq_printf(s, ";0x%lx", stack->ip[i]);
+	for (; i >= 0; i--)
+		seq_printf(s, ";%ps", (void *)stack->ip[i]);
+	seq_printf(s, " %lu\n", e->count);
+	return 0;
+}
+
+static const struct seq_operations stackprof_seq_ops = {
+	.start	= stackprof_seq_start,
+	.next	= stackprof_seq_next,
+	.stop	= stackprof_seq_stop,
+	.show	= stackprof_seq_show,
+};
+
+static int stackprof_stacks_open(struct inode *inode, struct file *file)
+{
+	return seq_open(file, &stackprof_seq_ops);
+}
+
+/* Any write clears the table */
+static ssize_t stackprof_stacks_write(struct file *file,
+				      const char __user *buf, size_t count,
+				      loff_t *ppos)
+{
+	mutex_lock(&stackprof_mutex);
+	if (stackprof_table) {
+		stackprof_drain_rings();
+		memset(stackprof_table, 0,
+		       STACKPROF_ENTRIES * sizeof(*stackprof_table));
+		stackprof_used = 0;
+		stackprof_samples = 0;
+		stackprof_dropped = 0;
+	}
+	mutex_unlock(&stackprof_mutex);
+	return count;
+}
+
+static const struct file_operations stackprof_stacks_fops = {
+	.open		= stackprof_stacks_open,
+	.read		= seq_read,
+	.write		= stackprof_stacks_write,
+	.llseek		= seq_lseek,
+	.release	= seq_release,
+};
+
+static int stackprof_stats_show(struct seq_file *s, void *data)
+{
+	unsigned long lost = 0;
+	int cpu;
+
+	mutex_lock(&stackprof_mutex);
+	if (stackprof_cpus)
+		for_each_possible_cpu(cpu)
+			lost += stackprof_cpus[cpu].lost;
+
+	seq_printf(s, "samples %lu\n", stackprof_samples);
+	seq_printf(s, "lost %lu\n", lost);
+	seq_printf(s, "dropped %lu\n", stackprof_dropped);
+	seq_printf(s, "stacks %u/%u\n", stackprof_used, STACKPROF_ENTRIES);
+	mutex_unlock(&stackprof_mutex);
+	return 0;
+}
+
+static int stackprof_stats_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, stackprof_stats_show, NULL);
+}
+
+static const struct file_operations stackprof_stats_fops = {
+	.open		= stackprof_stats_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init stackprof_init(void)
+{
+	struct dentry *dir;
+
+	dir = debugfs_create_dir("stackprof", NULL);
+	if (!dir)
+		return -ENOMEM;
+
+	debugfs_create_file("enable", 0600, dir, NULL, &stackprof_enable_fops);
+	debugfs_create_u32("frequency", 0600, dir, &stackprof_frequency);
+	debugfs_create_u32("use_clock", 0600, dir, &stackprof_use_clock);
+	debugfs_create_file("stacks", 0600, dir, NULL, &stackprof_stacks_fops);
+	debugfs_create_file("stats", 0400, dir, NULL, &stackprof_stats_fops);
+	return 0;
+}
+late_initcall(stackprof_init);
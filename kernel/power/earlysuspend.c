@@ -13,10 +13,13 @@
  *
  */
 
+#include <linux/async.h>
+#include <linux/debugfs.h>
 #include <linux/earlysuspend.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
 #include <linux/rtc.h>
+#include <linux/seq_file.h>
 #include <linux/syscalls.h> /* sys_sync */
 #include <linux/wakelock.h>
 #include <linux/workqueue.h>
@@ -31,6 +34,10 @@ enum {
 static int debug_mask = DEBUG_USER_STATE;
 module_param_named(debug_mask, debug_mask, int, S_IRUGO | S_IWUSR | S_IWGRP);
 
+/* Run handlers that share a level concurrently */
+static bool async_handlers = 1;
+module_param_named(async, async_handlers, bool, S_IRUGO | S_IWUSR | S_IWGRP);
+
 static DEFINE_MUTEX(early_suspend_lock);
 static LIST_HEAD(early_suspend_handlers);
 static void early_suspend(struct work_struct *work);
@@ -45,6 +52,10 @@ enum {
 };
 static int state;
 
+static LIST_HEAD(early_suspend_async_domain);
+static ktime_t early_suspend_total_time;
+static ktime_t late_resume_total_time;
+
 void register_early_suspend(struct early_suspend *handler)
 {
 	struct list_head *pos;
@@ -71,10 +82,98 @@ void unregister_early_suspend(struct early_suspend *handler)
 }
 EXPORT_SYMBOL(unregister_early_suspend);
 
-static void early_suspend(struct work_struct *work)
+static void call_early_suspend(struct early_suspend *h)
+{
+	ktime_t start = ktime_get();
+
+	if (debug_mask & DEBUG_VERBOSE)
+		pr_info("early_suspend: calling %pf\n", h->suspend);
+	h->suspend(h);
+	h->suspend_time = ktime_sub(ktime_get(), start);
+	if (ktime_to_ns(h->suspend_time) > ktime_to_ns(h->suspend_max_time))
+		h->suspend_max_time = h->suspend_time;
+}
+
+static void call_late_resume(struct early_suspend *h)
+{
+	ktime_t start = ktime_get();
+
+	if (debug_mask & DEBUG_VERBOSE)
+		pr_info("late_resume: calling %pf\n", h->resume);
+	h->resume(h);
+	h->resume_time = ktime_sub(ktime_get(), start);
+	if (ktime_to_ns(h->resume_time) > ktime_to_ns(h->resume_max_time))
+		h->resume_max_time = h->resume_time;
+}
+
+static void async_early_suspend(void *data, async_cookie_t cookie)
+{
+	call_early_suspend(data);
+}
+
+static void async_late_resume(void *data, async_cookie_t cookie)
+{
+	call_late_resume(data);
+}
+
+/*
+ * Call the suspend or resume hook of every handler. Levels are processed in
+ * order (ascending for suspend, descending for resume) and all handlers of a
+ * level must complete before the next level starts. Called with
+ * early_suspend_lock held.
+ */
+static void call_handlers(bool resume)
 {
 	struct early_suspend *pos;
+	int level = 0;
+	int pending = 0;
+
+	if (resume)
+		pos = list_entry(early_suspend_handlers.prev,
+				 struct early_suspend, link);
+	else
+		pos = list_entry(early_suspend_handlers.next,
+				 struct early_suspend, link);
+
+	while (&pos->link != &early_suspend_handlers) {
+		if (pending && pos->level != level) {
+			async_synchronize_full_domain(
+				&early_suspend_async_domain);
+			pending = 0;
+		}
+		level = pos->level;
+
+		if (resume && pos->resume != NULL) {
+			if (async_handlers) {
+				async_schedule_domain(async_late_resume, pos,
+						&early_suspend_async_domain);
+				pending = 1;
+			} else
+				call_late_resume(pos);
+		} else if (!resume && pos->suspend != NULL) {
+			if (async_handlers) {
+				async_schedule_domain(async_early_suspend, pos,
+						&early_suspend_async_domain);
+				pending = 1;
+			} else
+				call_early_suspend(pos);
+		}
+
+		if (resume)
+			pos = list_entry(pos->link.prev,
+					 struct early_suspend, link);
+		else
+			pos = list_entry(pos->link.next,
+					 struct early_suspend, link);
+	}
+	if (pending)
+		async_synchronize_full_domain(&early_suspend_async_domain);
+}
+
+static void early_suspend(struct work_struct *work)
+{
 	unsigned long irqflags;
+	ktime_t start;
 	int abort = 0;
 
 	mutex_lock(&early_suspend_lock);
@@ -94,13 +193,9 @@ static void early_suspend(struct work_struct *work)
 
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("early_suspend: call handlers\n");
-	list_for_each_entry(pos, &early_suspend_handlers, link) {
-		if (pos->suspend != NULL) {
-			if (debug_mask & DEBUG_VERBOSE)
-				pr_info("early_suspend: calling %pf\n", pos->suspend);
-			pos->suspend(pos);
-		}
-	}
+	start = ktime_get();
+	call_handlers(false);
+	early_suspend_total_time = ktime_sub(ktime_get(), start);
 	mutex_unlock(&early_suspend_lock);
 
 	if (debug_mask & DEBUG_SUSPEND)
@@ -116,8 +211,8 @@ abort:
 
 static void late_resume(struct work_struct *work)
 {
-	struct early_suspend *pos;
 	unsigned long irqflags;
+	ktime_t start;
 	int abort = 0;
 
 	mutex_lock(&early_suspend_lock);
@@ -135,16 +230,12 @@ static void late_resume(struct work_struct *work)
 	}
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("late_resume: call handlers\n");
-	list_for_each_entry_reverse(pos, &early_suspend_handlers, link) {
-		if (pos->resume != NULL) {
-			if (debug_mask & DEBUG_VERBOSE)
-				pr_info("late_resume: calling %pf\n", pos->resume);
-
-			pos->resume(pos);
-		}
-	}
+	start = ktime_get();
+	call_handlers(true);
+	late_resume_total_time = ktime_sub(ktime_get(), start);
 	if (debug_mask & DEBUG_SUSPEND)
-		pr_info("late_resume: done\n");
+		pr_info("late_resume: done in %lld usecs\n",
+			ktime_to_us(late_resume_total_time));
 abort:
 	mutex_unlock(&early_suspend_lock);
 }
@@ -185,3 +276,57 @@ suspend_state_t get_suspend_state(void)
 {
 	return requested_suspend_state;
 }
+
+#ifdef CONFIG_DEBUG_FS
+static int early_suspend_debug_show(struct seq_file *s, void *data)
+{
+	struct early_suspend *pos;
+
+	mutex_lock(&early_suspend_lock);
+	seq_printf(s, "early_suspend total %lld us, late_resume total %lld us\n",
+		   ktime_to_us(early_suspend_total_time),
+		   ktime_to_us(late_resume_total_time));
+	seq_printf(s, "level   suspend(us)       max   resume(us)       max"
+		   "  handler\n");
+	list_for_each_entry(pos, &early_suspend_handlers, link) {
+		seq_printf(s, "%5d %13lld %9lld %12lld %9lld  %pf\n",
+			   pos->level,
+			   ktime_to_us(pos->suspend_time),
+			   ktime_to_us(pos->suspend_max_time),
+			   ktime_to_us(pos->resume_time),
+			   ktime_to_us(pos->resume_max_time),
+			   pos->resume ? (void *)pos->resume :
+					 (void *)pos->suspend);
+	}
+	mutex_unlock(&early_suspend_lock);
+	return 0;
+}
+
+static int early_suspend_debug_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, early_suspend_debug_show, NULL);
+}
+
+static const struct file_operations early_suspend_debug_fops = {
+	.open		= early_suspend_debug_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init early_suspend_debug_init(void)
+{
+	struct dentry *d;
+
+	d = debugfs_create_file("early_suspend_stats", 0444, NULL, NULL,
+		&early_suspend_debug_fops);
+	if (!d) {
+		pr_err("Failed to create early_suspend_stats debug file\n");
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+late_initcall(early_suspend_debug_init);
+#endif
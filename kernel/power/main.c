@@ -311,6 +311,7 @@ power_attr(pm_trace_dev_match);
 #ifdef CONFIG_USER_WAKELOCK
 power_attr(wake_lock);
 power_attr(wake_unlock);
+static struct kobj_attribute wake_lock_stats_attr = __ATTR_RO(wake_lock_stats);
 #endif
 
 static struct attribute * g[] = {
@@ -328,6 +329,7 @@ static struct attribute * g[] = {
 #ifdef CONFIG_USER_WAKELOCK
 	&wake_lock_attr.attr,
 	&wake_unlock_attr.attr,
+	&wake_lock_stats_attr.attr,
 #endif
 #endif
 	NULL,
@@ -262,6 +262,8 @@ ssize_t wake_unlock_show(struct kobject *kobj, struct kobj_attribute *attr,
 			char *buf);
 ssize_t  wake_unlock_store(struct kobject *kobj, struct kobj_attribute *attr,
 			const char *buf, size_t n);
+ssize_t wake_lock_stats_show(struct kobject *kobj, struct kobj_attribute *attr,
+			char *buf);
 #endif
 
 #ifdef CONFIG_EARLYSUSPEND
@@ -14,7 +14,10 @@
  */
 
 #include <linux/ctype.h>
+#include <linux/dcache.h>
+#include <linux/hash.h>
 #include <linux/module.h>
+#include <linux/ratelimit.h>
 #include <linux/wakelock.h>
 #include <linux/slab.h>
 
@@ -26,26 +29,123 @@ enum {
 	DEBUG_NEW	= BIT(2),
 	DEBUG_ACCESS	= BIT(3),
 	DEBUG_LOOKUP	= BIT(4),
+	DEBUG_GC	= BIT(5),
 };
 static int debug_mask = DEBUG_FAILURE;
 module_param_named(debug_mask, debug_mask, int, S_IRUGO | S_IWUSR | S_IWGRP);
 
+/*
+ * Upper bound on the number of user wake locks kept around.  When the table
+ * is full, the least recently used inactive lock is destroyed to make room
+ * for a new name.  Zero disables the limit.
+ */
+static unsigned int max_user_wake_locks = CONFIG_USER_WAKELOCK_LIMIT;
+module_param_named(max_user_wake_locks, max_user_wake_locks, uint,
+		   S_IRUGO | S_IWUSR | S_IWGRP);
+
+#define USER_WAKE_LOCK_HASH_BITS	6
+#define USER_WAKE_LOCK_HASH_SIZE	(1 << USER_WAKE_LOCK_HASH_BITS)
+
+#ifdef CONFIG_USER_WAKELOCK_GC
+/* Scan for stale locks once every USER_WAKE_LOCK_GC_COUNT unlocks */
+#define USER_WAKE_LOCK_GC_COUNT		100
+#define USER_WAKE_LOCK_GC_TIME		(300 * HZ)
+static unsigned int unlocks_since_gc;
+#endif
+
 static DEFINE_MUTEX(tree_lock);
 
 struct user_wake_lock {
-	struct rb_node		node;
+	struct hlist_node	node;
+	struct list_head	lru;
+	unsigned long		last_used;
 	struct wake_lock	wake_lock;
 	char			name[0];
 };
-struct rb_root user_wake_locks;
+static struct hlist_head user_wake_lock_hash[USER_WAKE_LOCK_HASH_SIZE];
+/* Ordered from least to most recently used */
+static LIST_HEAD(user_wake_lock_lru);
+static unsigned int user_wake_lock_count;
+
+static struct {
+	unsigned long	lookups;
+	unsigned long	creations;
+	unsigned long	evictions;
+	unsigned long	collections;
+	unsigned long	failures;
+} user_wake_lock_stats;
+
+static inline struct hlist_head *user_wake_lock_bucket(const char *name,
+						       int name_len)
+{
+	unsigned int hash = full_name_hash(name, name_len);
+
+	return &user_wake_lock_hash[hash_32(hash, USER_WAKE_LOCK_HASH_BITS)];
+}
+
+static void user_wake_lock_touch(struct user_wake_lock *l)
+{
+	l->last_used = jiffies;
+	list_move_tail(&l->lru, &user_wake_lock_lru);
+}
+
+static void user_wake_lock_free(struct user_wake_lock *l)
+{
+	hlist_del(&l->node);
+	list_del(&l->lru);
+	user_wake_lock_count--;
+	wake_lock_destroy(&l->wake_lock);
+	kfree(l);
+}
+
+/* Destroy the least recently used inactive lock. Called with tree_lock held */
+static int user_wake_lock_evict(void)
+{
+	struct user_wake_lock *l;
+
+	list_for_each_entry(l, &user_wake_lock_lru, lru) {
+		if (wake_lock_active(&l->wake_lock))
+			continue;
+		if (debug_mask & DEBUG_GC)
+			pr_info("user_wake_lock_evict: %s\n", l->name);
+		user_wake_lock_free(l);
+		user_wake_lock_stats.evictions++;
+		return 0;
+	}
+	return -ENOSPC;
+}
+
+#ifdef CONFIG_USER_WAKELOCK_GC
+/* Destroy inactive locks that have not been used for a while */
+static void user_wake_lock_gc(void)
+{
+	struct user_wake_lock *l, *n;
+
+	if (++unlocks_since_gc < USER_WAKE_LOCK_GC_COUNT)
+		return;
+	unlocks_since_gc = 0;
+
+	list_for_each_entry_safe(l, n, &user_wake_lock_lru, lru) {
+		if (time_before(jiffies, l->last_used + USER_WAKE_LOCK_GC_TIME))
+			break;
+		if (wake_lock_active(&l->wake_lock))
+			continue;
+		if (debug_mask & DEBUG_GC)
+			pr_info("user_wake_lock_gc: %s\n", l->name);
+		user_wake_lock_free(l);
+		user_wake_lock_stats.collections++;
+	}
+}
+#else
+static inline void user_wake_lock_gc(void) {}
+#endif
 
 static struct user_wake_lock *lookup_wake_lock_name(
 	const char *buf, int allocate, long *timeoutptr)
 {
-	struct rb_node **p = &user_wake_locks.rb_node;
-	struct rb_node *parent = NULL;
+	struct hlist_head *head;
+	struct hlist_node *pos;
 	struct user_wake_lock *l;
-	int diff;
 	u64 timeout;
 	int name_len;
 	const char *arg;
@@ -78,45 +178,52 @@ static struct user_wake_lock *lookup_wake_lock_name(
 	else if (timeoutptr)
 		*timeoutptr = 0;
 
-	/* Lookup wake lock in rbtree */
-	while (*p) {
-		parent = *p;
-		l = rb_entry(parent, struct user_wake_lock, node);
-		diff = strncmp(buf, l->name, name_len);
-		if (!diff && l->name[name_len])
-			diff = -1;
-		if (debug_mask & DEBUG_ERROR)
-			pr_info("lookup_wake_lock_name: compare %.*s %s %d\n",
-				name_len, buf, l->name, diff);
-
-		if (diff < 0)
-			p = &(*p)->rb_left;
-		else if (diff > 0)
-			p = &(*p)->rb_right;
-		else
-			return l;
+	/* Lookup wake lock in hash table */
+	user_wake_lock_stats.lookups++;
+	head = user_wake_lock_bucket(buf, name_len);
+	hlist_for_each_entry(l, pos, head, node) {
+		if (strncmp(buf, l->name, name_len) || l->name[name_len])
+			continue;
+		if (debug_mask & DEBUG_LOOKUP)
+			pr_info("lookup_wake_lock_name: found %s\n", l->name);
+		user_wake_lock_touch(l);
+		return l;
 	}
 
-	/* Allocate and add new wakelock to rbtree */
+	/* Allocate and add new wakelock to hash table */
 	if (!allocate) {
 		if (debug_mask & DEBUG_ERROR)
 			pr_info("lookup_wake_lock_name: %.*s not found\n",
 				name_len, buf);
 		return ERR_PTR(-EINVAL);
 	}
+	if (max_user_wake_locks &&
+	    user_wake_lock_count >= max_user_wake_locks &&
+	    user_wake_lock_evict()) {
+		user_wake_lock_stats.failures++;
+		if (debug_mask & DEBUG_FAILURE)
+			pr_err_ratelimited("lookup_wake_lock_name: too many "
+				"active wake locks, rejecting %.*s\n",
+				name_len, buf);
+		return ERR_PTR(-ENOSPC);
+	}
 	l = kzalloc(sizeof(*l) + name_len + 1, GFP_KERNEL);
 	if (l == NULL) {
+		user_wake_lock_stats.failures++;
 		if (debug_mask & DEBUG_FAILURE)
-			pr_err("lookup_wake_lock_name: failed to allocate "
-				"memory for %.*s\n", name_len, buf);
+			pr_err_ratelimited("lookup_wake_lock_name: failed to "
+				"allocate memory for %.*s\n", name_len, buf);
 		return ERR_PTR(-ENOMEM);
 	}
 	memcpy(l->name, buf, name_len);
 	if (debug_mask & DEBUG_NEW)
 		pr_info("lookup_wake_lock_name: new wake lock %s\n", l->name);
 	wake_lock_init(&l->wake_lock, WAKE_LOCK_SUSPEND, l->name);
-	rb_link_node(&l->node, parent, p);
-	rb_insert_color(&l->node, &user_wake_locks);
+	hlist_add_head(&l->node, head);
+	INIT_LIST_HEAD(&l->lru);
+	user_wake_lock_touch(l);
+	user_wake_lock_count++;
+	user_wake_lock_stats.creations++;
 	return l;
 
 bad_arg:
@@ -131,13 +238,11 @@ ssize_t wake_lock_show(
 {
 	char *s = buf;
 	char *end = buf + PAGE_SIZE;
-	struct rb_node *n;
 	struct user_wake_lock *l;
 
 	mutex_lock(&tree_lock);
 
-	for (n = rb_first(&user_wake_locks); n != NULL; n = rb_next(n)) {
-		l = rb_entry(n, struct user_wake_lock, node);
+	list_for_each_entry(l, &user_wake_lock_lru, lru) {
 		if (wake_lock_active(&l->wake_lock))
 			s += scnprintf(s, end - s, "%s ", l->name);
 	}
@@ -179,13 +284,11 @@ ssize_t wake_unlock_show(
 {
 	char *s = buf;
 	char *end = buf + PAGE_SIZE;
-	struct rb_node *n;
 	struct user_wake_lock *l;
 
 	mutex_lock(&tree_lock);
 
-	for (n = rb_first(&user_wake_locks); n != NULL; n = rb_next(n)) {
-		l = rb_entry(n, struct user_wake_lock, node);
+	list_for_each_entry(l, &user_wake_lock_lru, lru) {
 		if (!wake_lock_active(&l->wake_lock))
 			s += scnprintf(s, end - s, "%s ", l->name);
 	}
@@ -212,8 +315,27 @@ ssize_t wake_unlock_store(
 		pr_info("wake_unlock_store: %s\n", l->name);
 
 	wake_unlock(&l->wake_lock);
+	user_wake_lock_gc();
 not_found:
 	mutex_unlock(&tree_lock);
 	return n;
 }
 
+ssize_t wake_lock_stats_show(
+	struct kobject *kobj, struct kobj_attribute *attr, char *buf)
+{
+	ssize_t len;
+
+	mutex_lock(&tree_lock);
+	len = scnprintf(buf, PAGE_SIZE,
+			"count %u\nlimit %u\nlookups %lu\ncreations %lu\n"
+			"evictions %lu\ncollections %lu\nfailures %lu\n",
+			user_wake_lock_count, max_user_wake_locks,
+			user_wake_lock_stats.lookups,
+			user_wake_lock_stats.creations,
+			user_wake_lock_stats.evictions,
+			user_wake_lock_stats.collections,
+			user_wake_lock_stats.failures);
+	mutex_unlock(&tree_lock);
+	return len;
+}
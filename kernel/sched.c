@@ -255,6 +255,8 @@ struct task_group {
 	/* runqueue "owned" by this group on each cpu */
 	struct cfs_rq **cfs_rq;
 	unsigned long shares;
+	/* wakeup preemption granularity in ns, 0 for the global default */
+	unsigned int wakeup_gran;
 
 	atomic_t load_weight;
 #endif
@@ -333,6 +335,13 @@ struct cfs_rq {
 	unsigned int nr_spread_over;
 #endif
 
+#ifdef CONFIG_SCHEDSTATS
+	/* wakeup-to-run latency of tasks queued on this cfs_rq */
+	u64 wakeup_lat_sum;
+	u64 wakeup_lat_max;
+	unsigned long wakeup_lat_count;
+#endif
+
 #ifdef CONFIG_FAIR_GROUP_SCHED
 	struct rq *rq;	/* cpu runqueue to which this cfs_rq is attached */
 
@@ -8633,6 +8642,28 @@ unsigned long sched_group_shares(struct task_group *tg)
 {
 	return tg->shares;
 }
+
+/*
+ * Tasks of a group with a wakeup granularity set preempt the running task
+ * on wakeup once they lag behind it by more than that many nanoseconds of
+ * virtual runtime, instead of sysctl_sched_wakeup_granularity.
+ */
+int sched_group_set_wakeup_gran(struct task_group *tg, u64 gran)
+{
+	if (tg == &root_task_group)
+		return -EINVAL;
+
+	if (gran > NSEC_PER_SEC)
+		return -EINVAL;
+
+	tg->wakeup_gran = gran;
+	return 0;
+}
+
+u64 sched_group_wakeup_gran(struct task_group *tg)
+{
+	return tg->wakeup_gran;
+}
 #endif
 
 #ifdef CONFIG_RT_GROUP_SCHED
@@ -9003,6 +9034,42 @@ static u64 cpu_shares_read_u64(struct cgroup *cgrp, struct cftype *cft)
 
 	return (u64) scale_load_down(tg->shares);
 }
+
+static int cpu_latency_write_u64(struct cgroup *cgrp, struct cftype *cftype,
+				 u64 gran)
+{
+	return sched_group_set_wakeup_gran(cgroup_tg(cgrp), gran);
+}
+
+static u64 cpu_latency_read_u64(struct cgroup *cgrp, struct cftype *cft)
+{
+	return sched_group_wakeup_gran(cgroup_tg(cgrp));
+}
+
+#ifdef CONFIG_SCHEDSTATS
+static int cpu_wakeup_latency_show(struct cgroup *cgrp, struct cftype *cft,
+				   struct cgroup_map_cb *cb)
+{
+	struct task_group *tg = cgroup_tg(cgrp);
+	u64 sum = 0, max = 0;
+	unsigned long count = 0;
+	int i;
+
+	for_each_possible_cpu(i) {
+		struct cfs_rq *cfs_rq = tg->cfs_rq[i];
+
+		sum += cfs_rq->wakeup_lat_sum;
+		max = max(max, cfs_rq->wakeup_lat_max);
+		count += cfs_rq->wakeup_lat_count;
+	}
+
+	cb->fill(cb, "count", count);
+	cb->fill(cb, "sum_ns", sum);
+	cb->fill(cb, "max_ns", max);
+	cb->fill(cb, "avg_ns", count ? div64_u64(sum, count) : 0);
+	return 0;
+}
+#endif
 #endif /* CONFIG_FAIR_GROUP_SCHED */
 
 #ifdef CONFIG_RT_GROUP_SCHED
@@ -9036,6 +9103,17 @@ static struct cftype cpu_files[] = {
 		.read_u64 = cpu_shares_read_u64,
 		.write_u64 = cpu_shares_write_u64,
 	},
+	{
+		.name = "latency",
+		.read_u64 = cpu_latency_read_u64,
+		.write_u64 = cpu_latency_write_u64,
+	},
+#ifdef CONFIG_SCHEDSTATS
+	{
+		.name = "wakeup_latency",
+		.read_map = cpu_wakeup_latency_show,
+	},
+#endif
 #endif
 #ifdef CONFIG_RT_GROUP_SCHED
 	{
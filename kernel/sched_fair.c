@@ -651,6 +651,35 @@ update_stats_dequeue(struct cfs_rq *cfs_rq, struct sched_entity *se)
 		update_stats_wait_end(cfs_rq, se);
 }
 
+#ifdef CONFIG_SCHEDSTATS
+/*
+ * A woken task gets to run: account the wakeup-to-run latency to the
+ * cfs_rq of its group.
+ */
+static void
+update_stats_wakeup_end(struct cfs_rq *cfs_rq, struct sched_entity *se)
+{
+	s64 delta;
+
+	if (!se->statistics.wakeup_start)
+		return;
+
+	delta = rq_of(cfs_rq)->clock - se->statistics.wakeup_start;
+	se->statistics.wakeup_start = 0;
+	if (delta < 0)
+		return;
+
+	cfs_rq->wakeup_lat_sum += delta;
+	cfs_rq->wakeup_lat_max = max_t(u64, cfs_rq->wakeup_lat_max, delta);
+	cfs_rq->wakeup_lat_count++;
+}
+#else
+static inline void
+update_stats_wakeup_end(struct cfs_rq *cfs_rq, struct sched_entity *se)
+{
+}
+#endif
+
 /*
  * We are picking a new current task - update its stats:
  */
@@ -990,6 +1019,9 @@ enqueue_entity(struct cfs_rq *cfs_rq, struct sched_entity *se, int flags)
 	if (flags & ENQUEUE_WAKEUP) {
 		place_entity(cfs_rq, se, 0);
 		enqueue_sleeper(cfs_rq, se);
+		if (entity_is_task(se))
+			schedstat_set(se->statistics.wakeup_start,
+				      rq_of(cfs_rq)->clock);
 	}
 
 	update_stats_enqueue(cfs_rq, se);
@@ -1146,6 +1178,7 @@ set_next_entity(struct cfs_rq *cfs_rq, struct sched_entity *se)
 		__dequeue_entity(cfs_rq, se);
 	}
 
+	update_stats_wakeup_end(cfs_rq, se);
 	update_stats_curr_start(cfs_rq, se);
 	cfs_rq->curr = se;
 #ifdef CONFIG_SCHEDSTATS
@@ -1806,10 +1839,8 @@ unlock:
 #endif /* CONFIG_SMP */
 
 static unsigned long
-wakeup_gran(struct sched_entity *curr, struct sched_entity *se)
+wakeup_gran(unsigned long gran, struct sched_entity *se)
 {
-	unsigned long gran = sysctl_sched_wakeup_granularity;
-
 	/*
 	 * Since its curr running now, convert the gran from real-time
 	 * to virtual-time in his units.
@@ -1826,6 +1857,22 @@ wakeup_gran(struct sched_entity *curr, struct sched_entity *se)
 	return calc_delta_fair(gran, se);
 }
 
+/*
+ * Wakeup granularity for @p: latency sensitive groups (cpu.latency) may
+ * use a smaller value than sysctl_sched_wakeup_granularity so that their
+ * tasks preempt background work sooner.
+ */
+static unsigned long task_wakeup_gran(struct task_struct *p)
+{
+#ifdef CONFIG_FAIR_GROUP_SCHED
+	unsigned long gran = task_cfs_rq(p)->tg->wakeup_gran;
+
+	if (gran)
+		return gran;
+#endif
+	return sysctl_sched_wakeup_granularity;
+}
+
 /*
  * Should 'se' preempt 'curr'.
  *
@@ -1841,20 +1888,27 @@ wakeup_gran(struct sched_entity *curr, struct sched_entity *se)
  *
  */
 static int
-wakeup_preempt_entity(struct sched_entity *curr, struct sched_entity *se)
+__wakeup_preempt_entity(struct sched_entity *curr, struct sched_entity *se,
+			unsigned long gran)
 {
-	s64 gran, vdiff = curr->vruntime - se->vruntime;
+	s64 vdiff = curr->vruntime - se->vruntime;
 
 	if (vdiff <= 0)
 		return -1;
 
-	gran = wakeup_gran(curr, se);
-	if (vdiff > gran)
+	if (vdiff > (s64)wakeup_gran(gran, se))
 		return 1;
 
 	return 0;
 }
 
+static int
+wakeup_preempt_entity(struct sched_entity *curr, struct sched_entity *se)
+{
+	return __wakeup_preempt_entity(curr, se,
+				       sysctl_sched_wakeup_granularity);
+}
+
 static void set_last_buddy(struct sched_entity *se)
 {
 	if (entity_is_task(se) && unlikely(task_of(se)->policy == SCHED_IDLE))
@@ -1924,7 +1978,7 @@ static void check_preempt_wakeup(struct rq *rq, struct task_struct *p, int wake_
 	update_curr(cfs_rq);
 	find_matching_se(&se, &pse);
 	BUG_ON(!pse);
-	if (wakeup_preempt_entity(se, pse) == 1) {
+	if (__wakeup_preempt_entity(se, pse, task_wakeup_gran(p)) == 1) {
 		/*
 		 * Bias pick_next to pick the sched entity that is
 		 * triggering this preemption.
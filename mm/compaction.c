@@ -15,6 +15,8 @@
 #include <linux/sysctl.h>
 #include <linux/sysfs.h>
 #include <linux/earlysuspend.h>
+#include <linux/kthread.h>
+#include <linux/freezer.h>
 #include "internal.h"
 
 #define CREATE_TRACE_POINTS
@@ -35,6 +37,7 @@ struct compact_control {
 	unsigned long free_pfn;		/* isolate_freepages search base */
 	unsigned long migrate_pfn;	/* isolate_migratepages search base */
 	bool sync;			/* Synchronous migration */
+	bool proactive;			/* Run by kcompactd */
 
 	/* Account for isolated anon and file pages */
 	unsigned long nr_anon;
@@ -566,6 +569,12 @@ static int compact_zone(struct zone *zone, struct compact_control *cc)
 
 		count_vm_event(COMPACTBLOCKS);
 		count_vm_events(COMPACTPAGES, nr_migrate - nr_remaining);
+		if (cc->proactive)
+			count_vm_events(COMPACTPROACTIVEPAGES,
+					nr_migrate - nr_remaining);
+		else if (cc->order != -1)
+			count_vm_events(COMPACTDIRECTPAGES,
+					nr_migrate - nr_remaining);
 		if (nr_remaining)
 			count_vm_events(COMPACTPAGEFAILED, nr_remaining);
 		trace_mm_compaction_migratepages(nr_migrate - nr_remaining,
@@ -654,6 +663,179 @@ unsigned long try_to_compact_pages(struct zonelist *zonelist,
 	return rc;
 }
 
+/*
+ * Proactive compaction: a per-node kcompactd thread is woken whenever an
+ * allocation of order > 0 enters the slow path, and compacts zones whose
+ * fragmentation index for orders up to sysctl_compact_proactive_order is
+ * above sysctl_compact_proactive_threshold, so that the next high-order
+ * allocation does not have to stall in direct compaction.
+ */
+int sysctl_compact_proactive = 1;
+int sysctl_compact_proactive_threshold = 800;
+int sysctl_compact_proactive_order = PAGE_ALLOC_COSTLY_ORDER;
+
+void wakeup_kcompactd(struct zone *zone, int order)
+{
+	pg_data_t *pgdat = zone->zone_pgdat;
+
+	if (!sysctl_compact_proactive || !pgdat->kcompactd)
+		return;
+
+	if (pgdat->kcompactd_max_order < order)
+		pgdat->kcompactd_max_order = order;
+	if (!waitqueue_active(&pgdat->kcompactd_wait))
+		return;
+
+	count_vm_event(KCOMPACTD_WAKE);
+	wake_up_interruptible(&pgdat->kcompactd_wait);
+}
+
+/*
+ * Highest order up to @max_order that would currently fail because of
+ * external fragmentation rather than lack of memory, or 0 if none.
+ */
+static int kcompactd_zone_order(struct zone *zone, int max_order)
+{
+	int order;
+
+	for (order = max_order; order > 0; order--)
+		if (fragmentation_index(zone, order) >
+		    sysctl_compact_proactive_threshold)
+			return order;
+	return 0;
+}
+
+/*
+ * An async background run that fails must not defer direct compaction,
+ * which can still succeed synchronously, so kcompactd backs off on its
+ * own counters, like defer_compaction() and compaction_deferred() do.
+ */
+static void kcompactd_defer(struct zone *zone)
+{
+	zone->kcompactd_considered = 0;
+	if (zone->kcompactd_defer_shift < COMPACT_MAX_DEFER_SHIFT)
+		zone->kcompactd_defer_shift++;
+}
+
+static bool kcompactd_deferred(struct zone *zone)
+{
+	unsigned long defer_limit = 1UL << zone->kcompactd_defer_shift;
+
+	if (++zone->kcompactd_considered > defer_limit)
+		zone->kcompactd_considered = defer_limit;
+	return zone->kcompactd_considered < defer_limit;
+}
+
+static void kcompactd_do_work(pg_data_t *pgdat)
+{
+	int zoneid, max_order;
+
+	max_order = max(xchg(&pgdat->kcompactd_max_order, 0),
+			sysctl_compact_proactive_order);
+	if (max_order >= MAX_ORDER)
+		max_order = MAX_ORDER - 1;
+
+	for (zoneid = 0; zoneid < MAX_NR_ZONES; zoneid++) {
+		struct zone *zone = &pgdat->node_zones[zoneid];
+		struct compact_control cc = {
+			.nr_freepages = 0,
+			.nr_migratepages = 0,
+			.migratetype = MIGRATE_MOVABLE,
+			.zone = zone,
+			.sync = false,
+			.proactive = true,
+		};
+
+		if (!populated_zone(zone) || kcompactd_deferred(zone))
+			continue;
+
+		cc.order = kcompactd_zone_order(zone, max_order);
+		if (!cc.order)
+			continue;
+
+		if (kthread_should_stop())
+			return;
+
+		INIT_LIST_HEAD(&cc.freepages);
+		INIT_LIST_HEAD(&cc.migratepages);
+
+		count_vm_event(COMPACTPROACTIVE);
+		compact_zone(zone, &cc);
+
+		if (kcompactd_zone_order(zone, cc.order) == cc.order)
+			kcompactd_defer(zone);
+		else
+			zone->kcompactd_defer_shift = 0;
+
+		VM_BUG_ON(!list_empty(&cc.freepages));
+		VM_BUG_ON(!list_empty(&cc.migratepages));
+	}
+}
+
+static int kcompactd(void *p)
+{
+	pg_data_t *pgdat = p;
+	const struct cpumask *cpumask = cpumask_of_node(pgdat->node_id);
+
+	if (!cpumask_empty(cpumask))
+		set_cpus_allowed_ptr(current, cpumask);
+
+	set_freezable();
+
+	while (!kthread_should_stop()) {
+		wait_event_freezable(pgdat->kcompactd_wait,
+				     pgdat->kcompactd_max_order ||
+				     kthread_should_stop());
+		if (!kthread_should_stop() && sysctl_compact_proactive)
+			kcompactd_do_work(pgdat);
+	}
+
+	return 0;
+}
+
+/*
+ * Called by init and node-hot-add, like kswapd_run().
+ */
+int kcompactd_run(int nid)
+{
+	pg_data_t *pgdat = NODE_DATA(nid);
+	int ret = 0;
+
+	if (pgdat->kcompactd)
+		return 0;
+
+	pgdat->kcompactd = kthread_run(kcompactd, pgdat, "kcompactd%d", nid);
+	if (IS_ERR(pgdat->kcompactd)) {
+		printk(KERN_ERR "Failed to start kcompactd on node %d\n", nid);
+		pgdat->kcompactd = NULL;
+		ret = -1;
+	}
+	return ret;
+}
+
+/*
+ * Called by memory hotplug when all memory in a node is offlined.
+ */
+void kcompactd_stop(int nid)
+{
+	struct task_struct *kcompactd = NODE_DATA(nid)->kcompactd;
+
+	if (kcompactd) {
+		kthread_stop(kcompactd);
+		NODE_DATA(nid)->kcompactd = NULL;
+	}
+}
+
+static int __init kcompactd_init(void)
+{
+	int nid;
+
+	for_each_node_state(nid, N_HIGH_MEMORY)
+		kcompactd_run(nid);
+	return 0;
+}
+module_init(kcompactd_init);
+
 #ifdef CONFIG_HAS_EARLYSUSPEND
 static struct work_struct compactnodes_w;
 static void compact_nodes(void);
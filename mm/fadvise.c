@@ -127,6 +127,16 @@ SYSCALL_DEFINE(fadvise64_64)(int fd, loff_t offset, loff_t len, int advice)
 			invalidate_mapping_pages(mapping, start_index,
 						end_index);
 		break;
+	case POSIX_FADV_RA_RECORD:
+		ret = ra_pattern_start_record(file);
+		break;
+	case POSIX_FADV_RA_REPLAY:
+		if (!mapping->a_ops->readpage) {
+			ret = -EINVAL;
+			break;
+		}
+		ra_pattern_replay(file, true);
+		break;
 	default:
 		ret = -EINVAL;
 	}
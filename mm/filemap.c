@@ -514,10 +514,18 @@ int add_to_page_cache_lru(struct page *page, struct address_space *mapping,
 
 	ret = add_to_page_cache(page, mapping, offset, gfp_mask);
 	if (ret == 0) {
-		if (page_is_file_cache(page))
-			lru_cache_add_file(page);
-		else
+		if (!page_is_file_cache(page))
 			lru_cache_add_anon(page);
+		else if (workingset_refault(mapping, offset)) {
+			/*
+			 * Refaulted within the active list size: activate it,
+			 * which also counts as a rotation of the file LRU and
+			 * shifts reclaim towards anon.
+			 */
+			workingset_activation(page);
+			lru_cache_add_lru(page, LRU_ACTIVE_FILE);
+		} else
+			lru_cache_add_file(page);
 	}
 	return ret;
 }
@@ -1106,6 +1114,8 @@ static void do_generic_file_read(struct file *filp, loff_t *ppos,
 		unsigned long nr, ret;
 
 		cond_resched();
+		if (unlikely(filp->f_mode & FMODE_RA_RECORD))
+			ra_pattern_record(filp, index);
 find_page:
 		page = find_get_page(mapping, index);
 		if (!page) {
@@ -1647,6 +1657,9 @@ int filemap_fault(struct vm_area_struct *vma, struct vm_fault *vmf)
 	if (offset >= size)
 		return VM_FAULT_SIGBUS;
 
+	if (unlikely(file->f_mode & FMODE_RA_RECORD))
+		ra_pattern_record(file, offset);
+
 	/*
 	 * Do we have something in the page cache already?
 	 */
@@ -23,7 +23,6 @@
 #include <linux/pagemap.h>
 #include <linux/rmap.h>
 #include <linux/spinlock.h>
-#include <linux/jhash.h>
 #include <linux/delay.h>
 #include <linux/kthread.h>
 #include <linux/wait.h>
@@ -92,6 +91,7 @@ struct mm_slot {
 	struct list_head mm_list;
 	struct rmap_item *rmap_list;
 	struct mm_struct *mm;
+	bool hot;
 };
 
 /**
@@ -189,6 +189,35 @@ static unsigned int ksm_thread_pages_to_scan = 100;
 /* Milliseconds ksmd should sleep between batches */
 static unsigned int ksm_thread_sleep_millisecs = 20;
 
+/*
+ * When set, ksmd scales the batch size between 1/8 and 8 times
+ * pages_to_scan according to the recent merge yield, and stretches its
+ * sleep so that scanning stays within ksm_cpu_budget percent of one CPU.
+ */
+static unsigned int ksm_auto_scan;
+static unsigned int ksm_cpu_budget = 10;
+static unsigned int ksm_auto_pages_to_scan = 100;
+
+/* Merge yield, in pages merged per thousand scanned, averaged over batches */
+#define KSM_YIELD_HIGH	10
+#define KSM_YIELD_LOW	1
+static unsigned int ksm_yield_avg;
+
+/* Pages freed by merging, and CPU time ksmd spent scanning */
+static unsigned long ksm_pages_merged;
+static u64 ksm_scan_cpu_ns;
+
+/*
+ * Zero-filled pages are merged straight into a single zero KSM page,
+ * without going through the unstable tree.
+ */
+static unsigned int ksm_merge_zero_pages = 1;
+static struct stable_node *ksm_zero_node;
+static u32 zero_checksum __read_mostly;
+
+/* Pages merged into the zero KSM page */
+static unsigned long ksm_pages_zero_merged;
+
 #define KSM_RUN_STOP	0
 #define KSM_RUN_MERGE	1
 #define KSM_RUN_UNMERGE	2
@@ -459,6 +488,8 @@ static void remove_node_from_stable_tree(struct stable_node *stable_node)
 	}
 
 	rb_erase(&stable_node->node, &root_stable_tree);
+	if (stable_node == ksm_zero_node)
+		ksm_zero_node = NULL;
 	free_stable_node(stable_node);
 }
 
@@ -669,25 +700,48 @@ error:
 }
 #endif /* CONFIG_SYSFS */
 
+/*
+ * The checksum is only used to notice pages that changed since the last
+ * scan, so it does not need to be a good hash: a Fletcher style sum over
+ * whole words catches any modification at a fraction of the cost of jhash2,
+ * and its independent lanes are easy work for wide load/add units.
+ */
 static u32 calc_checksum(struct page *page)
 {
-	u32 checksum;
-	void *addr = kmap_atomic(page, KM_USER0);
-	checksum = jhash2(addr, PAGE_SIZE / 4, 17);
+	unsigned long *addr = kmap_atomic(page, KM_USER0);
+	unsigned long a0 = 0, a1 = 0, b0 = 0, b1 = 0;
+	int i;
+
+	for (i = 0; i < PAGE_SIZE / sizeof(*addr); i += 2) {
+		a0 += addr[i];
+		a1 += addr[i + 1];
+		b0 += a0;
+		b1 += a1;
+	}
 	kunmap_atomic(addr, KM_USER0);
-	return checksum;
+	return hash_long(a0 ^ (b0 << 7) ^ (a1 << 13) ^ b1, 32);
 }
 
+/*
+ * Compare a word at a time, which is much faster than the byte loop of the
+ * generic memcmp(); the stable and unstable trees need a total order
+ * matching memcmp(), so the first differing word is resolved bytewise.
+ */
 static int memcmp_pages(struct page *page1, struct page *page2)
 {
-	char *addr1, *addr2;
-	int ret;
+	const unsigned long *addr1, *addr2;
+	int i, ret = 0;
 
 	addr1 = kmap_atomic(page1, KM_USER0);
 	addr2 = kmap_atomic(page2, KM_USER1);
-	ret = memcmp(addr1, addr2, PAGE_SIZE);
-	kunmap_atomic(addr2, KM_USER1);
-	kunmap_atomic(addr1, KM_USER0);
+	for (i = 0; i < PAGE_SIZE / sizeof(*addr1); i++) {
+		if (addr1[i] != addr2[i]) {
+			ret = memcmp(&addr1[i], &addr2[i], sizeof(*addr1));
+			break;
+		}
+	}
+	kunmap_atomic((void *)addr2, KM_USER1);
+	kunmap_atomic((void *)addr1, KM_USER0);
 	return ret;
 }
 
@@ -696,6 +750,21 @@ static inline int pages_identical(struct page *page1, struct page *page2)
 	return !memcmp_pages(page1, page2);
 }
 
+static int page_is_zero(struct page *page)
+{
+	unsigned long *addr = kmap_atomic(page, KM_USER0);
+	int i, ret = 1;
+
+	for (i = 0; i < PAGE_SIZE / sizeof(*addr); i++) {
+		if (addr[i]) {
+			ret = 0;
+			break;
+		}
+	}
+	kunmap_atomic(addr, KM_USER0);
+	return ret;
+}
+
 static int write_protect_page(struct vm_area_struct *vma, struct page *page,
 			      pte_t *orig_pte)
 {
@@ -1159,6 +1228,57 @@ static void stable_tree_append(struct rmap_item *rmap_item,
 		ksm_pages_shared++;
 }
 
+/*
+ * cmp_and_merge_zero_page - merge a zero-filled page into the zero KSM page.
+ *
+ * The first zero page found (or a zero page already in the stable tree)
+ * becomes the zero KSM page; later ones are merged with it directly,
+ * skipping the stable tree search and the unstable tree.
+ */
+static void cmp_and_merge_zero_page(struct page *page,
+				    struct rmap_item *rmap_item)
+{
+	struct stable_node *stable_node;
+	struct page *kpage = NULL;
+	int err;
+
+	if (ksm_zero_node)
+		kpage = get_ksm_page(ksm_zero_node);
+	if (!kpage) {
+		kpage = stable_tree_search(page);
+		if (kpage)
+			ksm_zero_node = page_stable_node(kpage);
+	}
+
+	if (kpage) {
+		err = try_to_merge_with_ksm_page(rmap_item, page, kpage);
+		if (!err) {
+			ksm_pages_merged++;
+			ksm_pages_zero_merged++;
+			lock_page(kpage);
+			stable_tree_append(rmap_item, page_stable_node(kpage));
+			unlock_page(kpage);
+		}
+		put_page(kpage);
+		return;
+	}
+
+	/* No zero KSM page yet: turn this page into it */
+	if (try_to_merge_with_ksm_page(rmap_item, page, NULL))
+		return;
+
+	lock_page(page);
+	stable_node = stable_tree_insert(page);
+	if (stable_node) {
+		stable_tree_append(rmap_item, stable_node);
+		ksm_zero_node = stable_node;
+	}
+	unlock_page(page);
+
+	if (!stable_node)
+		break_cow(rmap_item);
+}
+
 /*
  * cmp_and_merge_page - first see if page can be merged into the stable tree;
  * if not, compare checksum to previous and if it's the same, see if page can
@@ -1179,6 +1299,19 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 
 	remove_rmap_item_from_tree(rmap_item);
 
+	/*
+	 * Zero pages are the most common duplicates: merge them once they
+	 * have stayed zero for a full scan, like other pages are only put in
+	 * the unstable tree once their checksum is stable.
+	 */
+	if (ksm_merge_zero_pages && !PageKsm(page) && page_is_zero(page)) {
+		if (rmap_item->oldchecksum == zero_checksum)
+			cmp_and_merge_zero_page(page, rmap_item);
+		else
+			rmap_item->oldchecksum = zero_checksum;
+		return;
+	}
+
 	/* We first start with searching the page inside the stable tree */
 	kpage = stable_tree_search(page);
 	if (kpage) {
@@ -1188,6 +1321,7 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 			 * The page was successfully merged:
 			 * add its rmap_item to the stable tree.
 			 */
+			ksm_pages_merged++;
 			lock_page(kpage);
 			stable_tree_append(rmap_item, page_stable_node(kpage));
 			unlock_page(kpage);
@@ -1220,6 +1354,7 @@ static void cmp_and_merge_page(struct page *page, struct rmap_item *rmap_item)
 		 * tree, and insert it instead as new node in the stable tree.
 		 */
 		if (kpage) {
+			ksm_pages_merged++;
 			remove_rmap_item_from_tree(tree_rmap_item);
 
 			lock_page(kpage);
@@ -1272,6 +1407,22 @@ static struct rmap_item *get_next_rmap_item(struct mm_slot *mm_slot,
 	return rmap_item;
 }
 
+/*
+ * Start each full scan with the mms that have MADV_MERGEABLE_HOT areas, so
+ * that memory known to be highly duplicate gets merged first.
+ * Called with ksm_mmlist_lock held, and the cursor on ksm_mm_head.
+ */
+static void move_hot_mm_slots_first(void)
+{
+	struct mm_slot *slot, *next;
+	LIST_HEAD(hot_slots);
+
+	list_for_each_entry_safe(slot, next, &ksm_mm_head.mm_list, mm_list)
+		if (slot->hot)
+			list_move_tail(&slot->mm_list, &hot_slots);
+	list_splice(&hot_slots, &ksm_mm_head.mm_list);
+}
+
 static struct rmap_item *scan_get_next_rmap_item(struct page **page)
 {
 	struct mm_struct *mm;
@@ -1299,6 +1450,7 @@ static struct rmap_item *scan_get_next_rmap_item(struct page **page)
 		root_unstable_tree = RB_ROOT;
 
 		spin_lock(&ksm_mmlist_lock);
+		move_hot_mm_slots_first();
 		slot = list_entry(slot->mm_list.next, struct mm_slot, mm_list);
 		ksm_scan.mm_slot = slot;
 		spin_unlock(&ksm_mmlist_lock);
@@ -1406,21 +1558,67 @@ next_mm:
 /**
  * ksm_do_scan  - the ksm scanner main worker function.
  * @scan_npages - number of pages we want to scan before we return.
+ *
+ * Returns the number of pages actually scanned.
  */
-static void ksm_do_scan(unsigned int scan_npages)
+static unsigned int ksm_do_scan(unsigned int scan_npages)
 {
 	struct rmap_item *rmap_item;
 	struct page *uninitialized_var(page);
+	unsigned int scanned = 0;
 
-	while (scan_npages-- && likely(!freezing(current))) {
+	while (scanned < scan_npages && likely(!freezing(current))) {
 		cond_resched();
 		rmap_item = scan_get_next_rmap_item(&page);
 		if (!rmap_item)
-			return;
+			break;
 		if (!PageKsm(page) || !in_stable_tree(rmap_item))
 			cmp_and_merge_page(page, rmap_item);
 		put_page(page);
+		scanned++;
 	}
+	return scanned;
+}
+
+/*
+ * Run one batch, account its CPU time, and when auto scanning adapt the
+ * size of the next batch to the merge yield. Returns how long ksmd should
+ * sleep before the next batch, in milliseconds.
+ */
+static unsigned int ksm_scan_batch(void)
+{
+	unsigned long long cpu_start = task_sched_runtime(current);
+	unsigned long merged = ksm_pages_merged;
+	unsigned int scanned, yield, budget;
+	u64 cpu_ns;
+
+	if (!ksm_auto_scan) {
+		ksm_do_scan(ksm_thread_pages_to_scan);
+		ksm_scan_cpu_ns += task_sched_runtime(current) - cpu_start;
+		return ksm_thread_sleep_millisecs;
+	}
+
+	scanned = ksm_do_scan(ksm_auto_pages_to_scan);
+	cpu_ns = task_sched_runtime(current) - cpu_start;
+	ksm_scan_cpu_ns += cpu_ns;
+
+	if (scanned) {
+		yield = (ksm_pages_merged - merged) * 1000 / scanned;
+		ksm_yield_avg = (ksm_yield_avg * 3 + yield) / 4;
+	}
+
+	if (ksm_yield_avg >= KSM_YIELD_HIGH)
+		ksm_auto_pages_to_scan = min(ksm_auto_pages_to_scan * 2,
+					     ksm_thread_pages_to_scan * 8);
+	else if (ksm_yield_avg < KSM_YIELD_LOW)
+		ksm_auto_pages_to_scan = max(ksm_auto_pages_to_scan / 2,
+					     max(ksm_thread_pages_to_scan / 8, 1U));
+
+	/* Sleep long enough for the batch to fit in the CPU budget */
+	budget = clamp(ksm_cpu_budget, 1U, 100U);
+	cpu_ns = div_u64(cpu_ns * (100 - budget), budget);
+	return max_t(u64, ksm_thread_sleep_millisecs,
+		     div_u64(cpu_ns, NSEC_PER_MSEC));
 }
 
 static int ksmd_should_run(void)
@@ -1434,16 +1632,18 @@ static int ksm_scan_thread(void *nothing)
 	set_user_nice(current, 5);
 
 	while (!kthread_should_stop()) {
+		unsigned int sleep_millisecs = ksm_thread_sleep_millisecs;
+
 		mutex_lock(&ksm_thread_mutex);
 		if (ksmd_should_run())
-			ksm_do_scan(ksm_thread_pages_to_scan);
+			sleep_millisecs = ksm_scan_batch();
 		mutex_unlock(&ksm_thread_mutex);
 
 		try_to_freeze();
 
 		if (ksmd_should_run()) {
 			schedule_timeout_interruptible(
-				msecs_to_jiffies(ksm_thread_sleep_millisecs));
+				msecs_to_jiffies(sleep_millisecs));
 		} else {
 			wait_event_freezable(ksm_thread_wait,
 				ksmd_should_run() || kthread_should_stop());
@@ -1452,6 +1652,24 @@ static int ksm_scan_thread(void *nothing)
 	return 0;
 }
 
+/*
+ * Have ksmd scan @mm next, and first in every following full scan.
+ */
+static void ksm_mark_hot(struct mm_struct *mm)
+{
+	struct mm_slot *mm_slot;
+
+	spin_lock(&ksm_mmlist_lock);
+	mm_slot = get_mm_slot(mm);
+	if (mm_slot && !mm_slot->hot) {
+		mm_slot->hot = true;
+		if (ksm_scan.mm_slot != mm_slot)
+			list_move(&mm_slot->mm_list,
+				  &ksm_scan.mm_slot->mm_list);
+	}
+	spin_unlock(&ksm_mmlist_lock);
+}
+
 int ksm_madvise(struct vm_area_struct *vma, unsigned long start,
 		unsigned long end, int advice, unsigned long *vm_flags)
 {
@@ -1460,6 +1678,12 @@ int ksm_madvise(struct vm_area_struct *vma, unsigned long start,
 
 	switch (advice) {
 	case MADV_MERGEABLE:
+	case MADV_MERGEABLE_HOT:
+		/* Hinting an area that is already mergeable is fine */
+		if (advice == MADV_MERGEABLE_HOT && (*vm_flags & VM_MERGEABLE)) {
+			ksm_mark_hot(mm);
+			return 0;
+		}
 		/*
 		 * Be somewhat over-protective for now!
 		 */
@@ -1476,6 +1700,8 @@ int ksm_madvise(struct vm_area_struct *vma, unsigned long start,
 		}
 
 		*vm_flags |= VM_MERGEABLE;
+		if (advice == MADV_MERGEABLE_HOT)
+			ksm_mark_hot(mm);
 		break;
 
 	case MADV_UNMERGEABLE:
@@ -1867,11 +2093,69 @@ static ssize_t pages_to_scan_store(struct kobject *kobj,
 		return -EINVAL;
 
 	ksm_thread_pages_to_scan = nr_pages;
+	ksm_auto_pages_to_scan = nr_pages;
 
 	return count;
 }
 KSM_ATTR(pages_to_scan);
 
+static ssize_t auto_scan_show(struct kobject *kobj,
+			      struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_auto_scan);
+}
+
+static ssize_t auto_scan_store(struct kobject *kobj,
+			       struct kobj_attribute *attr,
+			       const char *buf, size_t count)
+{
+	int err;
+	unsigned long val;
+
+	err = strict_strtoul(buf, 10, &val);
+	if (err || val > 1)
+		return -EINVAL;
+
+	mutex_lock(&ksm_thread_mutex);
+	ksm_auto_scan = val;
+	ksm_auto_pages_to_scan = ksm_thread_pages_to_scan;
+	mutex_unlock(&ksm_thread_mutex);
+
+	return count;
+}
+KSM_ATTR(auto_scan);
+
+static ssize_t cpu_budget_percent_show(struct kobject *kobj,
+				       struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_cpu_budget);
+}
+
+static ssize_t cpu_budget_percent_store(struct kobject *kobj,
+					struct kobj_attribute *attr,
+					const char *buf, size_t count)
+{
+	int err;
+	unsigned long val;
+
+	err = strict_strtoul(buf, 10, &val);
+	if (err || !val || val > 100)
+		return -EINVAL;
+
+	ksm_cpu_budget = val;
+
+	return count;
+}
+KSM_ATTR(cpu_budget_percent);
+
+static ssize_t cur_pages_to_scan_show(struct kobject *kobj,
+				      struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_auto_scan ? ksm_auto_pages_to_scan :
+						    ksm_thread_pages_to_scan);
+}
+KSM_ATTR_RO(cur_pages_to_scan);
+
 static ssize_t run_show(struct kobject *kobj, struct kobj_attribute *attr,
 			char *buf)
 {
@@ -1966,15 +2250,80 @@ static ssize_t full_scans_show(struct kobject *kobj,
 }
 KSM_ATTR_RO(full_scans);
 
+static ssize_t merge_zero_pages_show(struct kobject *kobj,
+				     struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%u\n", ksm_merge_zero_pages);
+}
+
+static ssize_t merge_zero_pages_store(struct kobject *kobj,
+				      struct kobj_attribute *attr,
+				      const char *buf, size_t count)
+{
+	int err;
+	unsigned long val;
+
+	err = strict_strtoul(buf, 10, &val);
+	if (err || val > 1)
+		return -EINVAL;
+
+	ksm_merge_zero_pages = val;
+
+	return count;
+}
+KSM_ATTR(merge_zero_pages);
+
+static ssize_t pages_zero_merged_show(struct kobject *kobj,
+				      struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_pages_zero_merged);
+}
+KSM_ATTR_RO(pages_zero_merged);
+
+static ssize_t pages_merged_show(struct kobject *kobj,
+				 struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%lu\n", ksm_pages_merged);
+}
+KSM_ATTR_RO(pages_merged);
+
+static ssize_t scan_cpu_msecs_show(struct kobject *kobj,
+				   struct kobj_attribute *attr, char *buf)
+{
+	return sprintf(buf, "%llu\n",
+		       (unsigned long long)div_u64(ksm_scan_cpu_ns,
+						   NSEC_PER_MSEC));
+}
+KSM_ATTR_RO(scan_cpu_msecs);
+
+static ssize_t cpu_ns_per_merged_page_show(struct kobject *kobj,
+					   struct kobj_attribute *attr,
+					   char *buf)
+{
+	unsigned long merged = ksm_pages_merged;
+
+	return sprintf(buf, "%llu\n", merged ? (unsigned long long)
+		       div64_u64(ksm_scan_cpu_ns, merged) : 0ULL);
+}
+KSM_ATTR_RO(cpu_ns_per_merged_page);
+
 static struct attribute *ksm_attrs[] = {
 	&sleep_millisecs_attr.attr,
 	&pages_to_scan_attr.attr,
+	&auto_scan_attr.attr,
+	&cpu_budget_percent_attr.attr,
+	&cur_pages_to_scan_attr.attr,
+	&merge_zero_pages_attr.attr,
 	&run_attr.attr,
 	&pages_shared_attr.attr,
 	&pages_sharing_attr.attr,
 	&pages_unshared_attr.attr,
 	&pages_volatile_attr.attr,
 	&full_scans_attr.attr,
+	&pages_merged_attr.attr,
+	&pages_zero_merged_attr.attr,
+	&scan_cpu_msecs_attr.attr,
+	&cpu_ns_per_merged_page_attr.attr,
 	NULL,
 };
 
@@ -1993,6 +2342,8 @@ static int __init ksm_init(void)
 	if (err)
 		goto out;
 
+	zero_checksum = calc_checksum(ZERO_PAGE(0));
+
 	ksm_thread = kthread_run(ksm_scan_thread, NULL, "ksmd");
 	if (IS_ERR(ksm_thread)) {
 		printk(KERN_ERR "ksm: creating kthread failed\n");
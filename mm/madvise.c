@@ -66,6 +66,7 @@ static long madvise_behavior(struct vm_area_struct * vma,
 		new_flags &= ~VM_DONTCOPY;
 		break;
 	case MADV_MERGEABLE:
+	case MADV_MERGEABLE_HOT:
 	case MADV_UNMERGEABLE:
 		error = ksm_madvise(vma, start, end, behavior, &new_flags);
 		if (error)
@@ -287,6 +288,7 @@ madvise_behavior_valid(int behavior)
 	case MADV_DONTNEED:
 #ifdef CONFIG_KSM
 	case MADV_MERGEABLE:
+	case MADV_MERGEABLE_HOT:
 	case MADV_UNMERGEABLE:
 #endif
 #ifdef CONFIG_TRANSPARENT_HUGEPAGE
@@ -329,6 +331,8 @@ madvise_behavior_valid(int behavior)
  *  MADV_DOFORK - cancel MADV_DONTFORK: no longer omit this area when forking.
  *  MADV_MERGEABLE - the application recommends that KSM try to merge pages in
  *		this area with pages of identical content from other such areas.
+ *  MADV_MERGEABLE_HOT - as MADV_MERGEABLE, and the application expects the
+ *		area to hold many duplicate pages: KSM scans it first.
  *  MADV_UNMERGEABLE- cancel MADV_MERGEABLE: no longer merge pages with others.
  *
  * return values:
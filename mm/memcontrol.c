@@ -49,6 +49,8 @@
 #include <linux/page_cgroup.h>
 #include <linux/cpu.h>
 #include <linux/oom.h>
+#include <linux/hrtimer.h>
+#include <linux/workqueue.h>
 #include "internal.h"
 
 #include <asm/uaccess.h>
@@ -111,6 +113,13 @@ enum mem_cgroup_events_target {
 	MEM_CGROUP_TARGET_NUMAINFO,
 	MEM_CGROUP_NTARGETS,
 };
+/* Origin of a reclaim pass, for the reclaim time statistics */
+enum mem_cgroup_reclaim_origin {
+	MEM_CGROUP_RECLAIM_DIRECT,	/* a charge hit the limit */
+	MEM_CGROUP_RECLAIM_BACKGROUND,	/* usage went above the high wmark */
+	MEM_CGROUP_NR_RECLAIM_ORIGINS,
+};
+
 #define THRESHOLDS_EVENTS_TARGET (128)
 #define SOFTLIMIT_EVENTS_TARGET (1024)
 #define NUMAINFO_EVENTS_TARGET	(1024)
@@ -211,10 +220,9 @@ static void mem_cgroup_oom_notify(struct mem_cgroup *mem);
  * statistics based on the statistics developed by Rik Van Riel for clock-pro,
  * to help the administrator determine what knobs to tune.
  *
- * TODO: Add a water mark for the memory controller. Reclaim will begin when
- * we hit the water mark. May be even add a low water mark, such that
- * no reclaim occurs from a cgroup at it's low water mark, this is
- * a feature that will be implemented much later in the future.
+ * Background reclaim starts when usage goes above the high watermark and
+ * brings it back below the low watermark, so that tasks charging to the
+ * cgroup do not have to reclaim synchronously at the limit.
  */
 struct mem_cgroup {
 	struct cgroup_subsys_state css;
@@ -268,6 +276,15 @@ struct mem_cgroup {
 	/* For oom notifier event fd */
 	struct list_head oom_notify;
 
+	/* Background reclaim watermarks, in bytes */
+	unsigned long long high_wmark;
+	unsigned long long low_wmark;
+	struct work_struct bgreclaim_work;
+
+	/* Time spent in and number of reclaim passes, by origin */
+	atomic64_t	reclaim_ns[MEM_CGROUP_NR_RECLAIM_ORIGINS];
+	atomic_long_t	reclaim_count[MEM_CGROUP_NR_RECLAIM_ORIGINS];
+
 	/*
 	 * Should we move charges of a task when a task is moved into this
 	 * mem_cgroup ? And what type of charges should we move ?
@@ -693,6 +710,8 @@ static void __mem_cgroup_target_update(struct mem_cgroup *mem, int target)
 	this_cpu_write(mem->stat->targets[target], next);
 }
 
+static void mem_cgroup_check_wmark(struct mem_cgroup *mem);
+
 /*
  * Check events in order.
  *
@@ -702,6 +721,7 @@ static void memcg_check_events(struct mem_cgroup *mem, struct page *page)
 	/* threshold event is triggered in finer grain than soft limit */
 	if (unlikely(__memcg_event_check(mem, MEM_CGROUP_TARGET_THRESH))) {
 		mem_cgroup_threshold(mem);
+		mem_cgroup_check_wmark(mem);
 		__mem_cgroup_target_update(mem, MEM_CGROUP_TARGET_THRESH);
 		if (unlikely(__memcg_event_check(mem,
 			     MEM_CGROUP_TARGET_SOFTLIMIT))) {
@@ -1800,6 +1820,83 @@ static int mem_cgroup_hierarchical_reclaim(struct mem_cgroup *root_mem,
 	return total;
 }
 
+static void mem_cgroup_account_reclaim(struct mem_cgroup *mem,
+				       enum mem_cgroup_reclaim_origin origin,
+				       ktime_t start)
+{
+	atomic64_add(ktime_to_ns(ktime_sub(ktime_get(), start)),
+		     &mem->reclaim_ns[origin]);
+	atomic_long_inc(&mem->reclaim_count[origin]);
+}
+
+static struct workqueue_struct *memcg_bgreclaim_wq;
+
+/*
+ * Background reclaim: shrink the hierarchy under @mem until its usage is
+ * back below the low watermark, or reclaim stops making progress.
+ */
+static void mem_cgroup_bgreclaim_work(struct work_struct *work)
+{
+	struct mem_cgroup *mem = container_of(work, struct mem_cgroup,
+					      bgreclaim_work);
+	int nr_retries = MEM_CGROUP_RECLAIM_RETRIES;
+	ktime_t start = ktime_get();
+
+	while (res_counter_read_u64(&mem->res, RES_USAGE) > mem->low_wmark) {
+		if (!mem_cgroup_hierarchical_reclaim(mem, NULL, GFP_KERNEL,
+						     MEM_CGROUP_RECLAIM_SHRINK,
+						     NULL) &&
+		    !--nr_retries)
+			break;
+		cond_resched();
+	}
+
+	mem_cgroup_account_reclaim(mem, MEM_CGROUP_RECLAIM_BACKGROUND, start);
+	css_put(&mem->css);
+}
+
+/*
+ * The root cgroup is created from cgroup_init(), before workqueues can be
+ * set up, so the workqueue comes later. Until it exists, watermarks are
+ * not acted upon.
+ */
+static int __init mem_cgroup_bgreclaim_init(void)
+{
+	if (mem_cgroup_disabled())
+		return 0;
+	memcg_bgreclaim_wq = alloc_workqueue("memcg_bgreclaim",
+					     WQ_UNBOUND | WQ_MEM_RECLAIM, 0);
+	return 0;
+}
+subsys_initcall(mem_cgroup_bgreclaim_init);
+
+/*
+ * Kick background reclaim for @mem and any ancestor whose usage is above
+ * its high watermark. Called from charge event checks, so this must not
+ * sleep.
+ */
+static void mem_cgroup_check_wmark(struct mem_cgroup *mem)
+{
+	struct res_counter *counter;
+
+	if (!memcg_bgreclaim_wq)
+		return;
+
+	for (counter = &mem->res; counter; counter = counter->parent) {
+		struct mem_cgroup *iter = mem_cgroup_from_res_counter(counter,
+								      res);
+
+		if (res_counter_read_u64(counter, RES_USAGE) <= iter->high_wmark)
+			continue;
+		if (work_pending(&iter->bgreclaim_work))
+			continue;
+		if (!css_tryget(&iter->css))
+			continue;
+		if (!queue_work(memcg_bgreclaim_wq, &iter->bgreclaim_work))
+			css_put(&iter->css);
+	}
+}
+
 /*
  * Check OOM-Killer is already running under our hierarchy.
  * If someone is running, return false.
@@ -2212,6 +2309,7 @@ static int mem_cgroup_do_charge(struct mem_cgroup *mem, gfp_t gfp_mask,
 	struct mem_cgroup *mem_over_limit;
 	struct res_counter *fail_res;
 	unsigned long flags = 0;
+	ktime_t start;
 	int ret;
 
 	ret = res_counter_charge(&mem->res, csize, &fail_res);
@@ -2241,8 +2339,11 @@ static int mem_cgroup_do_charge(struct mem_cgroup *mem, gfp_t gfp_mask,
 	if (!(gfp_mask & __GFP_WAIT))
 		return CHARGE_WOULDBLOCK;
 
+	start = ktime_get();
 	ret = mem_cgroup_hierarchical_reclaim(mem_over_limit, NULL,
 					      gfp_mask, flags, NULL);
+	mem_cgroup_account_reclaim(mem_over_limit, MEM_CGROUP_RECLAIM_DIRECT,
+				   start);
 	if (mem_cgroup_margin(mem_over_limit) >= nr_pages)
 		return CHARGE_RETRY;
 	/*
@@ -3996,6 +4097,52 @@ static int mem_cgroup_write(struct cgroup *cont, struct cftype *cft,
 	return ret;
 }
 
+enum {
+	MEM_CGROUP_WMARK_HIGH,
+	MEM_CGROUP_WMARK_LOW,
+};
+
+static u64 mem_cgroup_wmark_read(struct cgroup *cont, struct cftype *cft)
+{
+	struct mem_cgroup *memcg = mem_cgroup_from_cont(cont);
+
+	if (cft->private == MEM_CGROUP_WMARK_HIGH)
+		return memcg->high_wmark;
+	return memcg->low_wmark;
+}
+
+/*
+ * Lowering the high watermark below the low one lowers the low one too;
+ * a low watermark above the high one is rejected.
+ */
+static int mem_cgroup_wmark_write(struct cgroup *cont, struct cftype *cft,
+				  const char *buffer)
+{
+	struct mem_cgroup *memcg = mem_cgroup_from_cont(cont);
+	unsigned long long val;
+	int ret;
+
+	if (mem_cgroup_is_root(memcg))
+		return -EINVAL;
+
+	ret = res_counter_memparse_write_strategy(buffer, &val);
+	if (ret)
+		return ret;
+
+	if (cft->private == MEM_CGROUP_WMARK_HIGH) {
+		memcg->high_wmark = val;
+		if (memcg->low_wmark > val)
+			memcg->low_wmark = val;
+	} else {
+		if (val > memcg->high_wmark)
+			return -EINVAL;
+		memcg->low_wmark = val;
+	}
+
+	mem_cgroup_check_wmark(memcg);
+	return 0;
+}
+
 static void memcg_get_hierarchical_limit(struct mem_cgroup *memcg,
 		unsigned long long *mem_limit, unsigned long long *memsw_limit)
 {
@@ -4099,6 +4246,10 @@ enum {
 	MCS_INACTIVE_FILE,
 	MCS_ACTIVE_FILE,
 	MCS_UNEVICTABLE,
+	MCS_DIRECT_RECLAIM,
+	MCS_DIRECT_RECLAIM_TIME,
+	MCS_BACKGROUND_RECLAIM,
+	MCS_BACKGROUND_RECLAIM_TIME,
 	NR_MCS_STAT,
 };
 
@@ -4122,7 +4273,11 @@ struct {
 	{"active_anon", "total_active_anon"},
 	{"inactive_file", "total_inactive_file"},
 	{"active_file", "total_active_file"},
-	{"unevictable", "total_unevictable"}
+	{"unevictable", "total_unevictable"},
+	{"direct_reclaim", "total_direct_reclaim"},
+	{"direct_reclaim_time", "total_direct_reclaim_time"},
+	{"background_reclaim", "total_background_reclaim"},
+	{"background_reclaim_time", "total_background_reclaim_time"},
 };
 
 
@@ -4162,6 +4317,16 @@ mem_cgroup_get_local_stat(struct mem_cgroup *mem, struct mcs_total_stat *s)
 	s->stat[MCS_ACTIVE_FILE] += val * PAGE_SIZE;
 	val = mem_cgroup_get_local_zonestat(mem, LRU_UNEVICTABLE);
 	s->stat[MCS_UNEVICTABLE] += val * PAGE_SIZE;
+
+	/* reclaim stat */
+	s->stat[MCS_DIRECT_RECLAIM] +=
+		atomic_long_read(&mem->reclaim_count[MEM_CGROUP_RECLAIM_DIRECT]);
+	s->stat[MCS_DIRECT_RECLAIM_TIME] +=
+		atomic64_read(&mem->reclaim_ns[MEM_CGROUP_RECLAIM_DIRECT]);
+	s->stat[MCS_BACKGROUND_RECLAIM] += atomic_long_read(
+		&mem->reclaim_count[MEM_CGROUP_RECLAIM_BACKGROUND]);
+	s->stat[MCS_BACKGROUND_RECLAIM_TIME] +=
+		atomic64_read(&mem->reclaim_ns[MEM_CGROUP_RECLAIM_BACKGROUND]);
 }
 
 static void
@@ -4694,6 +4859,18 @@ static struct cftype mem_cgroup_files[] = {
 		.write_string = mem_cgroup_write,
 		.read_u64 = mem_cgroup_read,
 	},
+	{
+		.name = "high_wmark_in_bytes",
+		.private = MEM_CGROUP_WMARK_HIGH,
+		.write_string = mem_cgroup_wmark_write,
+		.read_u64 = mem_cgroup_wmark_read,
+	},
+	{
+		.name = "low_wmark_in_bytes",
+		.private = MEM_CGROUP_WMARK_LOW,
+		.write_string = mem_cgroup_wmark_write,
+		.read_u64 = mem_cgroup_wmark_read,
+	},
 	{
 		.name = "failcnt",
 		.private = MEMFILE_PRIVATE(_MEM, RES_FAILCNT),
@@ -4995,6 +5172,9 @@ mem_cgroup_create(struct cgroup_subsys *ss, struct cgroup *cont)
 	mem->last_scanned_child = 0;
 	mem->last_scanned_node = MAX_NUMNODES;
 	INIT_LIST_HEAD(&mem->oom_notify);
+	mem->high_wmark = RESOURCE_MAX;
+	mem->low_wmark = RESOURCE_MAX;
+	INIT_WORK(&mem->bgreclaim_work, mem_cgroup_bgreclaim_work);
 
 	if (parent)
 		mem->swappiness = get_swappiness(parent);
@@ -5013,6 +5193,9 @@ static int mem_cgroup_pre_destroy(struct cgroup_subsys *ss,
 {
 	struct mem_cgroup *mem = mem_cgroup_from_cont(cont);
 
+	/* A queued background reclaim holds a css reference */
+	if (cancel_work_sync(&mem->bgreclaim_work))
+		css_put(&mem->css);
 	return mem_cgroup_force_empty(mem, false);
 }
 
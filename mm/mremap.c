@@ -137,6 +137,7 @@ unsigned long move_page_tables(struct vm_area_struct *vma,
 
 	old_end = old_addr + len;
 	flush_cache_range(vma, old_addr, old_end);
+	split_large_pages_range(vma, old_addr, old_end);
 
 	for (; old_addr < old_end; old_addr += extent, new_addr += extent) {
 		cond_resched();
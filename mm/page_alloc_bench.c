@@ -0,0 +1,308 @@
+/*
+ * mm/page_alloc_bench.c
+ *
+ * Page allocator benchmark.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Loading the module fragments memory with shmem pages, every other one of
+ * which is then freed, and times nr_allocs allocations of the given order
+ * while the fragmentation lasts. It reports the latency distribution and
+ * the compaction activity, e.g. to compare direct compaction with
+ * kcompactd by running it with /proc/sys/vm/compact_proactive at 0 and 1:
+ *
+ *	insmod page_alloc_bench.ko order=3 nr_allocs=256 fragment_mb=64
+ *
+ * With mixed=1 it instead runs a thread on every online CPU that allocates
+ * and frees batches of pages of orders 0 to PAGE_ALLOC_COSTLY_ORDER, and
+ * reports the time per allocation and how often the per-cpu lists served
+ * the high-order ones, e.g. to compare vm.percpu_pagelist_high_order 0 and 3:
+ *
+ *	insmod page_alloc_bench.ko mixed=1 nr_loops=10000
+ *
+ * Like tcrypt, the module fails to load once it is done, so that it can be
+ * loaded again right away.
+ */
+
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/completion.h>
+#include <linux/cpu.h>
+#include <linux/delay.h>
+#include <linux/err.h>
+#include <linux/file.h>
+#include <linux/fs.h>
+#include <linux/gfp.h>
+#include <linux/hrtimer.h>
+#include <linux/kthread.h>
+#include <linux/log2.h>
+#include <linux/math64.h>
+#include <linux/mm.h>
+#include <linux/pagemap.h>
+#include <linux/random.h>
+#include <linux/shmem_fs.h>
+#include <linux/slab.h>
+#include <linux/vmstat.h>
+
+static unsigned int order = 3;
+module_param(order, uint, 0444);
+MODULE_PARM_DESC(order, "Order of the timed allocations");
+
+static unsigned int nr_allocs = 256;
+module_param(nr_allocs, uint, 0444);
+MODULE_PARM_DESC(nr_allocs, "Number of timed allocations");
+
+static unsigned int fragment_mb = 64;
+module_param(fragment_mb, uint, 0444);
+MODULE_PARM_DESC(fragment_mb, "Memory to fragment before the test, in MB");
+
+static unsigned int interval_ms = 10;
+module_param(interval_ms, uint, 0444);
+MODULE_PARM_DESC(interval_ms, "Pause between timed allocations");
+
+static bool mixed;
+module_param(mixed, bool, 0444);
+MODULE_PARM_DESC(mixed, "Run the multi-CPU mixed-order test instead");
+
+static unsigned int nr_loops = 10000;
+module_param(nr_loops, uint, 0444);
+MODULE_PARM_DESC(nr_loops, "Batches allocated and freed per CPU by the "
+		 "mixed-order test");
+
+#define NR_BUCKETS	16	/* power of two microsecond buckets */
+
+/*
+ * Fill a shmem file and punch out every other page. The pages left are on
+ * the LRU and can be migrated, so compaction is able to undo the damage.
+ */
+static struct file *bench_fragment(void)
+{
+	pgoff_t i, nr = (pgoff_t)fragment_mb << (20 - PAGE_SHIFT);
+	struct address_space *mapping;
+	struct file *file;
+	struct page *page;
+
+	file = shmem_file_setup("page_alloc_bench", (loff_t)nr << PAGE_SHIFT,
+				VM_NORESERVE);
+	if (IS_ERR(file))
+		return file;
+
+	mapping = file->f_mapping;
+	for (i = 0; i < nr; i++) {
+		page = shmem_read_mapping_page(mapping, i);
+		if (IS_ERR(page))
+			break;
+		page_cache_release(page);
+		cond_resched();
+	}
+	nr = i;
+
+	for (i = 0; i < nr; i += 2)
+		shmem_truncate_range(mapping->host, (loff_t)i << PAGE_SHIFT,
+				     ((loff_t)(i + 1) << PAGE_SHIFT) - 1);
+	return file;
+}
+
+static void bench_report_events(unsigned long *before, unsigned long *after)
+{
+#ifdef CONFIG_COMPACTION
+	static const struct {
+		const char *name;
+		int item;
+	} events[] = {
+		{ "compact_stall",	COMPACTSTALL },
+		{ "compact_fail",	COMPACTFAIL },
+		{ "compact_success",	COMPACTSUCCESS },
+		{ "compact_daemon_wake", KCOMPACTD_WAKE },
+		{ "compact_proactive",	COMPACTPROACTIVE },
+		{ "compact_pages_moved", COMPACTPAGES },
+	};
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(events); i++)
+		pr_info("page_alloc_bench: %-20s %lu\n", events[i].name,
+			after[events[i].item] - before[events[i].item]);
+#endif
+}
+
+static int bench_high_order(void)
+{
+	unsigned long hist[NR_BUCKETS] = { 0 };
+	unsigned long *events, failed = 0;
+	u64 lat, sum = 0, max = 0;
+	struct page **pages;
+	struct file *file;
+	ktime_t start;
+	int i, b;
+
+	pages = kcalloc(nr_allocs, sizeof(*pages), GFP_KERNEL);
+	events = kcalloc(2 * NR_VM_EVENT_ITEMS, sizeof(*events), GFP_KERNEL);
+	if (!pages || !events) {
+		kfree(pages);
+		kfree(events);
+		return -ENOMEM;
+	}
+
+	file = bench_fragment();
+	if (IS_ERR(file)) {
+		kfree(pages);
+		kfree(events);
+		return PTR_ERR(file);
+	}
+
+	all_vm_events(events);
+	for (i = 0; i < nr_allocs; i++) {
+		start = ktime_get();
+		pages[i] = alloc_pages(GFP_KERNEL | __GFP_NOWARN, order);
+		lat = ktime_us_delta(ktime_get(), start);
+
+		if (!pages[i])
+			failed++;
+		sum += lat;
+		if (lat > max)
+			max = lat;
+		b = lat ? min_t(int, ilog2(lat) + 1, NR_BUCKETS - 1) : 0;
+		hist[b]++;
+
+		if (interval_ms)
+			msleep(interval_ms);
+	}
+	all_vm_events(events + NR_VM_EVENT_ITEMS);
+
+	pr_info("page_alloc_bench: order %u, %u allocations, %lu failed, "
+		"avg %llu us, max %llu us\n", order, nr_allocs, failed,
+		nr_allocs ? div_u64(sum, nr_allocs) : 0, max);
+	for (b = 0; b < NR_BUCKETS; b++)
+		if (hist[b])
+			pr_info("page_alloc_bench: %s %6lu us: %lu\n",
+				b < NR_BUCKETS - 1 ? "< " : ">=",
+				b < NR_BUCKETS - 1 ? 1UL << b : 1UL << (b - 1),
+				hist[b]);
+	bench_report_events(events, events + NR_VM_EVENT_ITEMS);
+
+	for (i = 0; i < nr_allocs; i++)
+		if (pages[i])
+			__free_pages(pages[i], order);
+	fput(file);
+	kfree(pages);
+	kfree(events);
+	return 0;
+}
+
+#define MIXED_BATCH	16
+
+struct bench_thread {
+	struct task_struct	*task;
+	struct completion	done;
+	u64			ns;
+	unsigned long		failed;
+};
+
+static int bench_mixed_thread(void *data)
+{
+	struct bench_thread *bt = data;
+	struct page *pages[MIXED_BATCH];
+	unsigned int orders[MIXED_BATCH];
+	ktime_t start;
+	int i, j;
+
+	start = ktime_get();
+	for (i = 0; i < nr_loops; i++) {
+		for (j = 0; j < MIXED_BATCH; j++) {
+			orders[j] = random32() % (PAGE_ALLOC_COSTLY_ORDER + 1);
+			pages[j] = alloc_pages(GFP_KERNEL | __GFP_NOWARN,
+					       orders[j]);
+			if (!pages[j])
+				bt->failed++;
+		}
+		for (j = 0; j < MIXED_BATCH; j++)
+			if (pages[j])
+				__free_pages(pages[j], orders[j]);
+		cond_resched();
+	}
+	bt->ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	complete(&bt->done);
+	return 0;
+}
+
+static int bench_mixed(void)
+{
+	u64 allocs = (u64)nr_loops * MIXED_BATCH;
+	struct bench_thread *threads;
+	unsigned long *events;
+	int cpu, ret = 0;
+
+	threads = kcalloc(nr_cpu_ids, sizeof(*threads), GFP_KERNEL);
+	events = kcalloc(2 * NR_VM_EVENT_ITEMS, sizeof(*events), GFP_KERNEL);
+	if (!threads || !events) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	get_online_cpus();
+	for_each_online_cpu(cpu) {
+		struct bench_thread *bt = &threads[cpu];
+
+		init_completion(&bt->done);
+		bt->task = kthread_create(bench_mixed_thread, bt,
+					  "page_alloc_bench/%d", cpu);
+		if (IS_ERR(bt->task)) {
+			ret = PTR_ERR(bt->task);
+			bt->task = NULL;
+			break;
+		}
+		kthread_bind(bt->task, cpu);
+	}
+
+	if (ret) {
+		/* The threads have not run yet, so they exit right away */
+		for_each_online_cpu(cpu)
+			if (threads[cpu].task)
+				kthread_stop(threads[cpu].task);
+		put_online_cpus();
+		goto out;
+	}
+
+	all_vm_events(events);
+	for_each_online_cpu(cpu)
+		wake_up_process(threads[cpu].task);
+	for_each_online_cpu(cpu)
+		wait_for_completion(&threads[cpu].done);
+	all_vm_events(events + NR_VM_EVENT_ITEMS);
+	put_online_cpus();
+
+	for_each_online_cpu(cpu)
+		pr_info("page_alloc_bench: cpu %d: %llu ns per allocation, "
+			"%lu failed\n", cpu,
+			div64_u64(threads[cpu].ns, allocs), threads[cpu].failed);
+
+	pr_info("page_alloc_bench: pcp_high_order_hit %lu, "
+		"pcp_high_order_miss %lu\n",
+		events[NR_VM_EVENT_ITEMS + PCP_HIGH_ORDER_HIT] -
+		events[PCP_HIGH_ORDER_HIT],
+		events[NR_VM_EVENT_ITEMS + PCP_HIGH_ORDER_MISS] -
+		events[PCP_HIGH_ORDER_MISS]);
+ out:
+	kfree(threads);
+	kfree(events);
+	return ret;
+}
+
+static int __init page_alloc_bench_init(void)
+{
+	int ret;
+
+	if (order >= MAX_ORDER)
+		return -EINVAL;
+
+	ret = mixed ? bench_mixed() : bench_high_order();
+	return ret ? ret : -EAGAIN;
+}
+module_init(page_alloc_bench_init);
+
+MODULE_DESCRIPTION("Page allocator benchmark");
+MODULE_LICENSE("GPL");
@@ -20,6 +20,9 @@
 #include <linux/writeback.h>
 #include <asm/pgtable.h>
 
+/* Most pages a batched swap-out bio is allowed to gather */
+#define SWAP_PLUG_PAGES		32
+
 static struct bio *get_swap_bio(gfp_t gfp_flags,
 				struct page *page, bio_end_io_t end_io)
 {
@@ -43,26 +46,34 @@ static struct bio *get_swap_bio(gfp_t gfp_flags,
 static void end_swap_bio_write(struct bio *bio, int err)
 {
 	const int uptodate = test_bit(BIO_UPTODATE, &bio->bi_flags);
-	struct page *page = bio->bi_io_vec[0].bv_page;
+	int i;
 
-	if (!uptodate) {
-		SetPageError(page);
-		/*
-		 * We failed to write the page out to swap-space.
-		 * Re-dirty the page in order to avoid it being reclaimed.
-		 * Also print a dire warning that things will go BAD (tm)
-		 * very quickly.
-		 *
-		 * Also clear PG_reclaim to avoid rotate_reclaimable_page()
-		 */
-		set_page_dirty(page);
+	if (!uptodate)
 		printk(KERN_ALERT "Write-error on swap-device (%u:%u:%Lu)\n",
 				imajor(bio->bi_bdev->bd_inode),
 				iminor(bio->bi_bdev->bd_inode),
 				(unsigned long long)bio->bi_sector);
-		ClearPageReclaim(page);
+
+	/* Batched swap-out bios carry more than one page */
+	for (i = 0; i < bio->bi_vcnt; i++) {
+		struct page *page = bio->bi_io_vec[i].bv_page;
+
+		if (!uptodate) {
+			SetPageError(page);
+			/*
+			 * We failed to write the page out to swap-space.
+			 * Re-dirty the page in order to avoid it being
+			 * reclaimed. The message above is the dire warning
+			 * that things will go BAD (tm) very quickly.
+			 *
+			 * Also clear PG_reclaim to avoid
+			 * rotate_reclaimable_page()
+			 */
+			set_page_dirty(page);
+			ClearPageReclaim(page);
+		}
+		end_page_writeback(page);
 	}
-	end_page_writeback(page);
 	bio_put(bio);
 }
 
@@ -85,6 +96,63 @@ void end_swap_bio_read(struct bio *bio, int err)
 	bio_put(bio);
 }
 
+/**
+ * swap_write_unplug - submit a batched swap-out bio
+ * @bio: bio gathered by swap_writepage() in wbc->swap_plug, may be NULL
+ *
+ * Must be called before waiting on the writeback of any page that may
+ * have been added to @bio, and before anything that may need a bio from
+ * the same mempool, such as another filesystem's ->writepage().
+ */
+void swap_write_unplug(struct bio *bio)
+{
+	if (!bio)
+		return;
+	if (bio->bi_vcnt > 1)
+		count_vm_events(PSWPOUT_BATCHED, bio->bi_vcnt);
+	else
+		count_vm_event(PSWPOUT_SINGLE);
+	submit_bio(WRITE, bio);
+}
+
+/*
+ * Add @page to the bio pending in *@plug if it lands right behind it on
+ * the same device, otherwise submit the pending bio and start a new one.
+ */
+static void swap_writepage_plugged(struct page *page, struct bio **plug)
+{
+	struct block_device *bdev;
+	struct bio *bio = *plug;
+	sector_t sector;
+
+	sector = map_swap_page(page, &bdev) << (PAGE_SHIFT - 9);
+	if (bio && (bio->bi_bdev != bdev ||
+		    bio->bi_sector + (bio->bi_size >> 9) != sector ||
+		    bio_add_page(bio, page, PAGE_SIZE, 0) != PAGE_SIZE)) {
+		swap_write_unplug(bio);
+		bio = NULL;
+	}
+
+	if (!bio) {
+		/* Cannot fail: it waits for the bio mempool */
+		bio = bio_alloc(GFP_NOIO, SWAP_PLUG_PAGES);
+		bio->bi_bdev = bdev;
+		bio->bi_sector = sector;
+		bio->bi_end_io = end_swap_bio_write;
+		bio_add_page(bio, page, PAGE_SIZE, 0);
+	}
+
+	count_vm_event(PSWPOUT);
+	set_page_writeback(page);
+	unlock_page(page);
+
+	if (bio->bi_vcnt == bio->bi_max_vecs) {
+		swap_write_unplug(bio);
+		bio = NULL;
+	}
+	*plug = bio;
+}
+
 /*
  * We may have stale swap cache pages in memory: notice
  * them here and get rid of the unnecessary final write.
@@ -98,6 +166,10 @@ int swap_writepage(struct page *page, struct writeback_control *wbc)
 		unlock_page(page);
 		goto out;
 	}
+	if (wbc->swap_plug && wbc->sync_mode == WB_SYNC_NONE) {
+		swap_writepage_plugged(page, wbc->swap_plug);
+		goto out;
+	}
 	bio = get_swap_bio(GFP_NOIO, page, end_swap_bio_write);
 	if (bio == NULL) {
 		set_page_dirty(page);
@@ -107,7 +179,9 @@ int swap_writepage(struct page *page, struct writeback_control *wbc)
 	}
 	if (wbc->sync_mode == WB_SYNC_ALL)
 		rw |= REQ_SYNC;
+	ret = 0;
 	count_vm_event(PSWPOUT);
+	count_vm_event(PSWPOUT_SINGLE);
 	set_page_writeback(page);
 	unlock_page(page);
 	submit_bio(rw, bio);
@@ -0,0 +1,520 @@
+/*
+ * mm/ra_pattern.c - recorded readahead patterns.
+ *
+ * Applications that mmap large files and touch them at random, such as
+ * a launching app touching its APK and odex files, defeat both the
+ * sequential readahead heuristics and mmap read-around: every fault turns
+ * into a small read of its own.
+ *
+ * A pattern is the sorted set of page ranges of a file that were accessed
+ * while it was being recorded. Recording is switched on for an open file
+ * with fadvise(POSIX_FADV_RA_RECORD) and lasts until the file is released.
+ * Page faults and read()s on the file add their page index to the pattern,
+ * and ranges separated by small holes are merged so that replay issues
+ * fewer, larger reads.
+ *
+ * Later opens of the same file (identified by device and inode number)
+ * replay the pattern: all ranges are submitted for readahead in ascending
+ * order under a single block plug, from a workqueue so that open() does not
+ * wait for it. POSIX_FADV_RA_REPLAY replays on demand, synchronously.
+ *
+ * Patterns are found under RCU and each has its own lock, so recording
+ * does not serialize on anything shared. ra_pattern_mutex only protects
+ * adding and removing patterns and their LRU list: when RA_PATTERN_MAX
+ * patterns exist, the one recorded or replayed least recently is dropped
+ * to make room for a new one.
+ *
+ * /proc/readahead_patterns lists all patterns, one per line, as
+ *
+ *	<major>:<minor> <ino> <start>+<nr> <start>+<nr> ...
+ *
+ * Writing a line in the same format loads a pattern, e.g. one saved before
+ * the last reboot. Writing "clear" drops all patterns.
+ */
+
+#include <linux/kernel.h>
+#include <linux/fs.h>
+#include <linux/mm.h>
+#include <linux/blkdev.h>
+#include <linux/file.h>
+#include <linux/hash.h>
+#include <linux/init.h>
+#include <linux/jiffies.h>
+#include <linux/mutex.h>
+#include <linux/proc_fs.h>
+#include <linux/rculist.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/uaccess.h>
+#include <linux/workqueue.h>
+
+#define RA_PATTERN_HASH_BITS	6
+#define RA_PATTERN_MAX		256	/* patterns kept at most */
+#define RA_PATTERN_EXTENTS	128	/* page ranges per pattern */
+#define RA_PATTERN_GAP		4	/* holes merged into a range, in pages */
+#define RA_PATTERN_INTERVAL	(30 * HZ)	/* min time between replays */
+
+struct ra_extent {
+	pgoff_t start;
+	unsigned long nr;
+};
+
+struct ra_pattern {
+	struct hlist_node hash;		/* RCU, changed under ra_pattern_mutex */
+	struct list_head list;		/* LRU, under ra_pattern_mutex */
+	struct rcu_head rcu;
+	dev_t dev;
+	unsigned long ino;
+	spinlock_t lock;		/* protects the fields below */
+	unsigned long last_replay;	/* jiffies */
+	unsigned int nr_extents;
+	struct ra_extent extents[RA_PATTERN_EXTENTS];
+};
+
+struct ra_pattern_work {
+	struct work_struct work;
+	struct file *file;
+};
+
+static DEFINE_MUTEX(ra_pattern_mutex);
+static struct hlist_head ra_pattern_hash[1 << RA_PATTERN_HASH_BITS];
+static LIST_HEAD(ra_pattern_list);	/* least recently used first */
+static unsigned int nr_ra_patterns;
+
+static struct hlist_head *ra_pattern_head(dev_t dev, unsigned long ino)
+{
+	return &ra_pattern_hash[hash_long(ino ^ dev, RA_PATTERN_HASH_BITS)];
+}
+
+/* Called under rcu_read_lock() or ra_pattern_mutex */
+static struct ra_pattern *ra_pattern_lookup(dev_t dev, unsigned long ino)
+{
+	struct ra_pattern *p;
+	struct hlist_node *node;
+
+	hlist_for_each_entry_rcu(p, node, ra_pattern_head(dev, ino), hash)
+		if (p->dev == dev && p->ino == ino)
+			return p;
+	return NULL;
+}
+
+static struct ra_pattern *ra_pattern_lookup_file(struct file *file)
+{
+	struct inode *inode = file->f_mapping->host;
+
+	return ra_pattern_lookup(inode->i_sb->s_dev, inode->i_ino);
+}
+
+static void ra_pattern_free(struct ra_pattern *p)
+{
+	hlist_del_rcu(&p->hash);
+	list_del(&p->list);
+	nr_ra_patterns--;
+	kfree_rcu(p, rcu);
+}
+
+/*
+ * Find or create the pattern of (@dev, @ino), emptying an existing one.
+ * Called under ra_pattern_mutex.
+ */
+static struct ra_pattern *ra_pattern_new(dev_t dev, unsigned long ino)
+{
+	struct ra_pattern *p;
+
+	p = ra_pattern_lookup(dev, ino);
+	if (p) {
+		spin_lock(&p->lock);
+		p->nr_extents = 0;
+		spin_unlock(&p->lock);
+		list_move_tail(&p->list, &ra_pattern_list);
+		return p;
+	}
+
+	p = kzalloc(sizeof(*p), GFP_KERNEL);
+	if (!p)
+		return NULL;
+	if (nr_ra_patterns >= RA_PATTERN_MAX)
+		ra_pattern_free(list_first_entry(&ra_pattern_list,
+						 struct ra_pattern, list));
+	p->dev = dev;
+	p->ino = ino;
+	spin_lock_init(&p->lock);
+	p->last_replay = jiffies - RA_PATTERN_INTERVAL;
+	list_add_tail(&p->list, &ra_pattern_list);
+	hlist_add_head_rcu(&p->hash, ra_pattern_head(dev, ino));
+	nr_ra_patterns++;
+	return p;
+}
+
+static pgoff_t ra_extent_end(struct ra_extent *e)
+{
+	return e->start + e->nr;
+}
+
+/* Merge extent @i with its successors while the holes between are small */
+static void ra_pattern_merge_next(struct ra_pattern *p, unsigned int i)
+{
+	struct ra_extent *e = &p->extents[i], *next = e + 1;
+
+	while (i + 1 < p->nr_extents &&
+	       next->start <= ra_extent_end(e) + RA_PATTERN_GAP) {
+		e->nr = max(ra_extent_end(e), ra_extent_end(next)) - e->start;
+		p->nr_extents--;
+		memmove(next, next + 1,
+			(p->nr_extents - i - 1) * sizeof(*next));
+	}
+}
+
+/*
+ * Add @index to the sorted extents of @p. Returns the extent now covering
+ * @index, or -1 if the pattern is full.
+ */
+static int ra_pattern_add(struct ra_pattern *p, pgoff_t index)
+{
+	unsigned int lo = 0, hi = p->nr_extents;
+	struct ra_extent *e;
+
+	/* Find the first extent starting after @index */
+	while (lo < hi) {
+		unsigned int mid = (lo + hi) / 2;
+
+		if (p->extents[mid].start <= index)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo > 0) {
+		e = &p->extents[lo - 1];
+		if (index < ra_extent_end(e))
+			return lo - 1;
+		if (index <= ra_extent_end(e) + RA_PATTERN_GAP) {
+			e->nr = index - e->start + 1;
+			ra_pattern_merge_next(p, lo - 1);
+			return lo - 1;
+		}
+	}
+
+	if (lo < p->nr_extents) {
+		e = &p->extents[lo];
+		if (e->start <= index + 1 + RA_PATTERN_GAP) {
+			e->nr += e->start - index;
+			e->start = index;
+			return lo;
+		}
+	}
+
+	if (p->nr_extents == RA_PATTERN_EXTENTS)
+		return -1;
+
+	e = &p->extents[lo];
+	memmove(e + 1, e, (p->nr_extents - lo) * sizeof(*e));
+	e->start = index;
+	e->nr = 1;
+	p->nr_extents++;
+	return lo;
+}
+
+/* Add the @nr pages starting at @start to the extents of @p */
+static void ra_pattern_add_range(struct ra_pattern *p, pgoff_t start,
+				 unsigned long nr)
+{
+	int i = ra_pattern_add(p, start);
+	struct ra_extent *e;
+
+	if (i < 0)
+		return;
+	e = &p->extents[i];
+	if (start + nr > ra_extent_end(e)) {
+		e->nr = start + nr - e->start;
+		ra_pattern_merge_next(p, i);
+	}
+}
+
+/**
+ * ra_pattern_record - add an access to the pattern being recorded
+ * @file: file being recorded, with FMODE_RA_RECORD set
+ * @index: page index that was accessed
+ */
+void ra_pattern_record(struct file *file, pgoff_t index)
+{
+	struct ra_pattern *p;
+
+	rcu_read_lock();
+	p = ra_pattern_lookup_file(file);
+	if (p) {
+		spin_lock(&p->lock);
+		ra_pattern_add(p, index);
+		spin_unlock(&p->lock);
+	}
+	rcu_read_unlock();
+}
+
+/**
+ * ra_pattern_start_record - start recording the access pattern of a file
+ * @file: file to record
+ *
+ * Any pattern recorded before for the same file is discarded.
+ */
+int ra_pattern_start_record(struct file *file)
+{
+	struct inode *inode = file->f_mapping->host;
+	struct ra_pattern *p;
+
+	if (!S_ISREG(inode->i_mode))
+		return -EINVAL;
+
+	mutex_lock(&ra_pattern_mutex);
+	p = ra_pattern_new(inode->i_sb->s_dev, inode->i_ino);
+	mutex_unlock(&ra_pattern_mutex);
+	if (!p)
+		return -ENOMEM;
+
+	spin_lock(&file->f_lock);
+	file->f_mode |= FMODE_RA_RECORD;
+	spin_unlock(&file->f_lock);
+	return 0;
+}
+
+/**
+ * ra_pattern_replay - read ahead the recorded pattern of a file
+ * @file: file to read ahead
+ * @force: replay even if the pattern was replayed recently
+ *
+ * Returns the number of ranges submitted for readahead.
+ */
+int ra_pattern_replay(struct file *file, bool force)
+{
+	struct address_space *mapping = file->f_mapping;
+	struct ra_extent *extents;
+	struct ra_pattern *p;
+	struct blk_plug plug;
+	unsigned int i, nr = 0;
+
+	if (!mapping->a_ops->readpage)
+		return 0;
+
+	extents = kmalloc(sizeof(*extents) * RA_PATTERN_EXTENTS, GFP_KERNEL);
+	if (!extents)
+		return 0;
+
+	mutex_lock(&ra_pattern_mutex);
+	p = ra_pattern_lookup_file(file);
+	if (p) {
+		spin_lock(&p->lock);
+		if (force || time_after_eq(jiffies,
+				p->last_replay + RA_PATTERN_INTERVAL)) {
+			nr = p->nr_extents;
+			memcpy(extents, p->extents, nr * sizeof(*extents));
+			p->last_replay = jiffies;
+		}
+		spin_unlock(&p->lock);
+		list_move_tail(&p->list, &ra_pattern_list);
+	}
+	mutex_unlock(&ra_pattern_mutex);
+
+	blk_start_plug(&plug);
+	for (i = 0; i < nr; i++)
+		force_page_cache_readahead(mapping, file, extents[i].start,
+					   extents[i].nr);
+	blk_finish_plug(&plug);
+
+	kfree(extents);
+	return nr;
+}
+
+static void ra_pattern_work_fn(struct work_struct *work)
+{
+	struct ra_pattern_work *rw;
+
+	rw = container_of(work, struct ra_pattern_work, work);
+	ra_pattern_replay(rw->file, true);
+	fput(rw->file);
+	kfree(rw);
+}
+
+/* Has the pattern of @file not been replayed recently? Claims the replay. */
+static bool ra_pattern_due(struct file *file)
+{
+	struct ra_pattern *p;
+	bool due = false;
+
+	rcu_read_lock();
+	p = ra_pattern_lookup_file(file);
+	if (p) {
+		spin_lock(&p->lock);
+		if (time_after_eq(jiffies,
+				  p->last_replay + RA_PATTERN_INTERVAL)) {
+			p->last_replay = jiffies;
+			due = true;
+		}
+		spin_unlock(&p->lock);
+	}
+	rcu_read_unlock();
+	return due;
+}
+
+/**
+ * ra_pattern_open - replay the pattern of a file being opened
+ * @file: newly opened file
+ *
+ * The replay runs from a workqueue, which holds a reference to @file.
+ */
+void ra_pattern_open(struct file *file)
+{
+	struct ra_pattern_work *rw;
+
+	if (likely(!nr_ra_patterns))
+		return;
+	if (!(file->f_mode & FMODE_READ) || (file->f_flags & O_DIRECT) ||
+	    !S_ISREG(file->f_mapping->host->i_mode))
+		return;
+	if (!file->f_mapping->a_ops->readpage || !ra_pattern_due(file))
+		return;
+
+	rw = kmalloc(sizeof(*rw), GFP_KERNEL);
+	if (!rw)
+		return;
+	INIT_WORK(&rw->work, ra_pattern_work_fn);
+	get_file(file);
+	rw->file = file;
+	queue_work(system_unbound_wq, &rw->work);
+}
+
+static void *ra_pattern_seq_start(struct seq_file *m, loff_t *pos)
+{
+	mutex_lock(&ra_pattern_mutex);
+	return seq_list_start(&ra_pattern_list, *pos);
+}
+
+static void *ra_pattern_seq_next(struct seq_file *m, void *v, loff_t *pos)
+{
+	return seq_list_next(v, &ra_pattern_list, pos);
+}
+
+static void ra_pattern_seq_stop(struct seq_file *m, void *v)
+{
+	mutex_unlock(&ra_pattern_mutex);
+}
+
+static int ra_pattern_seq_show(struct seq_file *m, void *v)
+{
+	struct ra_pattern *p = list_entry(v, struct ra_pattern, list);
+	unsigned int i;
+
+	seq_printf(m, "%u:%u %lu", MAJOR(p->dev), MINOR(p->dev), p->ino);
+	spin_lock(&p->lock);
+	for (i = 0; i < p->nr_extents; i++)
+		seq_printf(m, " %lu+%lu", p->extents[i].start, p->extents[i].nr);
+	spin_unlock(&p->lock);
+	seq_putc(m, '\n');
+	return 0;
+}
+
+static const struct seq_operations ra_pattern_seq_ops = {
+	.start	= ra_pattern_seq_start,
+	.next	= ra_pattern_seq_next,
+	.stop	= ra_pattern_seq_stop,
+	.show	= ra_pattern_seq_show,
+};
+
+static int ra_pattern_proc_open(struct inode *inode, struct file *file)
+{
+	return seq_open(file, &ra_pattern_seq_ops);
+}
+
+/* Parse one "<major>:<minor> <ino> <start>+<nr> ..." line */
+static int ra_pattern_load(char *line)
+{
+	unsigned int major, minor;
+	unsigned long ino, start, nr;
+	struct ra_pattern *p;
+	char *tok;
+	int ret = 0;
+
+	tok = strsep(&line, " ");
+	if (!tok || sscanf(tok, "%u:%u", &major, &minor) != 2)
+		return -EINVAL;
+	tok = strsep(&line, " ");
+	if (!tok || strict_strtoul(tok, 10, &ino))
+		return -EINVAL;
+
+	mutex_lock(&ra_pattern_mutex);
+	p = ra_pattern_new(MKDEV(major, minor), ino);
+	if (!p) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	while ((tok = strsep(&line, " ")) != NULL) {
+		if (!*tok)
+			continue;
+		if (sscanf(tok, "%lu+%lu", &start, &nr) != 2 || !nr ||
+		    start + nr < start) {
+			ra_pattern_free(p);
+			ret = -EINVAL;
+			goto out;
+		}
+		spin_lock(&p->lock);
+		ra_pattern_add_range(p, start, nr);
+		spin_unlock(&p->lock);
+	}
+out:
+	mutex_unlock(&ra_pattern_mutex);
+	return ret;
+}
+
+static ssize_t ra_pattern_proc_write(struct file *file, const char __user *buf,
+				     size_t count, loff_t *ppos)
+{
+	char *kbuf;
+	int ret;
+
+	if (!count || count > PAGE_SIZE)
+		return -EINVAL;
+
+	kbuf = kmalloc(count + 1, GFP_KERNEL);
+	if (!kbuf)
+		return -ENOMEM;
+	if (copy_from_user(kbuf, buf, count)) {
+		kfree(kbuf);
+		return -EFAULT;
+	}
+	kbuf[count] = '\0';
+	strim(kbuf);
+
+	if (!strcmp(kbuf, "clear")) {
+		struct ra_pattern *p, *next;
+
+		mutex_lock(&ra_pattern_mutex);
+		list_for_each_entry_safe(p, next, &ra_pattern_list, list)
+			ra_pattern_free(p);
+		mutex_unlock(&ra_pattern_mutex);
+		ret = 0;
+	} else
+		ret = ra_pattern_load(kbuf);
+
+	kfree(kbuf);
+	return ret ? ret : count;
+}
+
+static const struct file_operations ra_pattern_proc_fops = {
+	.open		= ra_pattern_proc_open,
+	.read		= seq_read,
+	.write		= ra_pattern_proc_write,
+	.llseek		= seq_lseek,
+	.release	= seq_release,
+};
+
+static int __init ra_pattern_init(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(ra_pattern_hash); i++)
+		INIT_HLIST_HEAD(&ra_pattern_hash[i]);
+
+	proc_create("readahead_patterns", S_IRUSR | S_IWUSR, NULL,
+		    &ra_pattern_proc_fops);
+	return 0;
+}
+module_init(ra_pattern_init);
@@ -0,0 +1,262 @@
+/*
+ * mm/slab_bench.c
+ *
+ * Slab allocator benchmark.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Loading the module starts a thread on every online CPU. All threads
+ * allocate batches of objects from one private cache at the same time and
+ * free them again, either on the same CPU or, with remote=1, on the next
+ * one, which makes the frees miss the cpu slab. It reports the average
+ * time per object allocated and freed. With bulk=1 the batches go through
+ * kmem_cache_alloc_bulk() and kmem_cache_free_bulk(), for a comparison
+ * with one call per object:
+ *
+ *	insmod slab_bench.ko obj_size=256 batch=16 nr_loops=100000
+ *	insmod slab_bench.ko obj_size=256 batch=16 nr_loops=100000 bulk=1
+ *
+ * The cache is not merged with others, so with CONFIG_SLUB_STATS the
+ * cpu_partial_* and node_list_lock counters in /sys/kernel/slab/slab_bench
+ * show how the run used the per-cpu partial lists.
+ *
+ * Like tcrypt, the module fails to load once it is done, so that it can be
+ * loaded again right away.
+ */
+
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/completion.h>
+#include <linux/cpu.h>
+#include <linux/err.h>
+#include <linux/hrtimer.h>
+#include <linux/kthread.h>
+#include <linux/math64.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+
+static unsigned int obj_size = 256;
+module_param(obj_size, uint, 0444);
+MODULE_PARM_DESC(obj_size, "Size of the objects");
+
+static unsigned int batch = 16;
+module_param(batch, uint, 0444);
+MODULE_PARM_DESC(batch, "Objects allocated before they are freed");
+
+static unsigned int nr_loops = 100000;
+module_param(nr_loops, uint, 0444);
+MODULE_PARM_DESC(nr_loops, "Batches per CPU");
+
+static bool remote;
+module_param(remote, bool, 0444);
+MODULE_PARM_DESC(remote, "Free the objects on the next CPU");
+
+static bool bulk;
+module_param(bulk, bool, 0444);
+MODULE_PARM_DESC(bulk, "Use kmem_cache_alloc_bulk() and kmem_cache_free_bulk()");
+
+#define MAX_BATCH	256
+
+struct bench_thread {
+	struct task_struct	*task;
+	struct completion	done;
+	void			**objs;
+	u64			ns;
+	unsigned long		failed;
+};
+
+static struct kmem_cache *bench_cache;
+static struct bench_thread *bench_threads;
+static atomic_t bench_arrived, bench_gen;
+
+/* A constructor keeps the cache from being merged with another one */
+static void bench_ctor(void *obj)
+{
+}
+
+static void bench_alloc_batch(struct bench_thread *bt, void **objs)
+{
+	int i;
+
+	if (bulk) {
+		/* All or nothing */
+		if (!kmem_cache_alloc_bulk(bench_cache, GFP_KERNEL, batch,
+					   objs)) {
+			memset(objs, 0, batch * sizeof(void *));
+			bt->failed += batch;
+		}
+		return;
+	}
+
+	for (i = 0; i < batch; i++) {
+		objs[i] = kmem_cache_alloc(bench_cache, GFP_KERNEL);
+		if (!objs[i])
+			bt->failed++;
+	}
+}
+
+static void bench_free_batch(void **objs)
+{
+	int i;
+
+	if (bulk) {
+		if (objs[0])
+			kmem_cache_free_bulk(bench_cache, batch, objs);
+		return;
+	}
+
+	for (i = 0; i < batch; i++)
+		if (objs[i])
+			kmem_cache_free(bench_cache, objs[i]);
+}
+
+/* The batch a CPU frees when remote is set: that of the previous CPU */
+static void **bench_prev_objs(int cpu)
+{
+	int prev, last = -1;
+
+	for_each_online_cpu(prev) {
+		if (prev == cpu && last >= 0)
+			return bench_threads[last].objs;
+		last = prev;
+	}
+	return bench_threads[last].objs;
+}
+
+/* Wait until all @nr threads got here */
+static void bench_barrier(int nr)
+{
+	int gen = atomic_read(&bench_gen);
+
+	if (atomic_inc_return(&bench_arrived) == nr) {
+		atomic_set(&bench_arrived, 0);
+		atomic_inc(&bench_gen);
+	} else {
+		while (atomic_read(&bench_gen) == gen)
+			cpu_relax();
+	}
+	smp_mb();
+}
+
+static int bench_thread_fn(void *data)
+{
+	struct bench_thread *bt = data;
+	int nr = num_online_cpus();
+	void **objs = bt->objs;
+	ktime_t start;
+	int i;
+
+	if (remote)
+		objs = bench_prev_objs(smp_processor_id());
+
+	for (i = 0; i < nr_loops; i++) {
+		start = ktime_get();
+		bench_alloc_batch(bt, bt->objs);
+		bt->ns += ktime_to_ns(ktime_sub(ktime_get(), start));
+
+		/* The previous CPU's batch is complete, and ours is */
+		if (remote)
+			bench_barrier(nr);
+
+		start = ktime_get();
+		bench_free_batch(objs);
+		bt->ns += ktime_to_ns(ktime_sub(ktime_get(), start));
+
+		/* Nobody refills a batch that is still being freed */
+		if (remote)
+			bench_barrier(nr);
+		else
+			cond_resched();
+	}
+
+	complete(&bt->done);
+	return 0;
+}
+
+static int bench_run(void)
+{
+	u64 ns = 0, objs = (u64)nr_loops * batch;
+	unsigned long failed = 0;
+	int cpu, nr = 0, ret = 0;
+
+	get_online_cpus();
+	for_each_online_cpu(cpu) {
+		struct bench_thread *bt = &bench_threads[cpu];
+
+		init_completion(&bt->done);
+		bt->objs = kcalloc(batch, sizeof(void *), GFP_KERNEL);
+		if (!bt->objs) {
+			ret = -ENOMEM;
+			break;
+		}
+		bt->task = kthread_create(bench_thread_fn, bt, "slab_bench/%d",
+					  cpu);
+		if (IS_ERR(bt->task)) {
+			ret = PTR_ERR(bt->task);
+			bt->task = NULL;
+			break;
+		}
+		kthread_bind(bt->task, cpu);
+		nr++;
+	}
+
+	if (!ret) {
+		for_each_online_cpu(cpu)
+			wake_up_process(bench_threads[cpu].task);
+		for_each_online_cpu(cpu) {
+			wait_for_completion(&bench_threads[cpu].done);
+			ns += bench_threads[cpu].ns;
+			failed += bench_threads[cpu].failed;
+		}
+	} else {
+		/* The threads have not run yet, so they exit right away */
+		for_each_online_cpu(cpu)
+			if (bench_threads[cpu].task)
+				kthread_stop(bench_threads[cpu].task);
+	}
+
+	for_each_online_cpu(cpu)
+		kfree(bench_threads[cpu].objs);
+	put_online_cpus();
+
+	if (!ret)
+		pr_info("slab_bench: %u byte objects, %d cpus, %s %u%s: "
+			"%llu ns per object, %lu failed\n", obj_size, nr,
+			bulk ? "bulk" : "batch", batch,
+			remote ? ", remote free" : "",
+			div64_u64(ns, objs * nr), failed);
+	return ret;
+}
+
+static int __init slab_bench_init(void)
+{
+	int ret;
+
+	if (!batch || batch > MAX_BATCH || !obj_size)
+		return -EINVAL;
+
+	bench_threads = kcalloc(nr_cpu_ids, sizeof(*bench_threads),
+				GFP_KERNEL);
+	if (!bench_threads)
+		return -ENOMEM;
+
+	bench_cache = kmem_cache_create("slab_bench", obj_size, 0, 0,
+					bench_ctor);
+	if (!bench_cache) {
+		kfree(bench_threads);
+		return -ENOMEM;
+	}
+
+	ret = bench_run();
+
+	kmem_cache_destroy(bench_cache);
+	kfree(bench_threads);
+	return ret ? ret : -EAGAIN;
+}
+module_init(slab_bench_init);
+
+MODULE_DESCRIPTION("Slab allocator benchmark");
+MODULE_LICENSE("GPL");
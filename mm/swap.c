@@ -285,6 +285,8 @@ static void __activate_page(struct page *page, void *arg)
 		lru += LRU_ACTIVE;
 		add_page_to_lru_list(zone, page, lru);
 		__count_vm_event(PGACTIVATE);
+		if (file)
+			workingset_activation(page);
 
 		update_page_reclaim_stat(zone, page, file, 1);
 	}
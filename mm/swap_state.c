@@ -295,6 +295,14 @@ struct page *read_swap_cache_async(swp_entry_t entry, gfp_t gfp_mask,
 		if (found_page)
 			break;
 
+		/*
+		 * A free slot sitting in a cpu's slot cache has SWAP_HAS_CACHE
+		 * set but no page, swapcache_prepare() would fail on it until
+		 * the slot gets used. Readahead has no business there.
+		 */
+		if (swap_slots_cache_enabled && !__swp_swapcount(entry))
+			break;
+
 		/*
 		 * Get a new page to read into from swap.
 		 */
@@ -32,6 +32,7 @@
 #include <linux/memcontrol.h>
 #include <linux/poll.h>
 #include <linux/oom.h>
+#include <linux/cpu.h>
 
 #include <asm/pgtable.h>
 #include <asm/tlbflush.h>
@@ -409,17 +410,24 @@ no_page:
 	return 0;
 }
 
-swp_entry_t get_swap_page(void)
+/*
+ * Allocate up to @n swap slots for the swap cache into @slots, taking
+ * swap_lock only once. Returns the number of slots allocated.
+ */
+static int get_swap_pages(int n, swp_entry_t slots[])
 {
 	struct swap_info_struct *si;
 	pgoff_t offset;
 	int type, next;
 	int wrapped = 0;
+	int nr = 0;
 
 	spin_lock(&swap_lock);
 	if (nr_swap_pages <= 0)
 		goto noswap;
-	nr_swap_pages--;
+	if (n > nr_swap_pages)
+		n = nr_swap_pages;
+	nr_swap_pages -= n;
 
 	for (type = swap_list.next; type >= 0 && wrapped < 2; type = next) {
 		si = swap_info[type];
@@ -437,18 +445,142 @@ swp_entry_t get_swap_page(void)
 
 		swap_list.next = next;
 		/* This is called for allocating swap entry for cache */
-		offset = scan_swap_map(si, SWAP_HAS_CACHE);
-		if (offset) {
-			spin_unlock(&swap_lock);
-			return swp_entry(type, offset);
+		while (nr < n) {
+			offset = scan_swap_map(si, SWAP_HAS_CACHE);
+			if (!offset)
+				break;
+			slots[nr++] = swp_entry(type, offset);
 		}
+		if (nr == n)
+			break;
 		next = swap_list.next;
 	}
 
-	nr_swap_pages++;
+	nr_swap_pages += n - nr;
 noswap:
 	spin_unlock(&swap_lock);
-	return (swp_entry_t) {0};
+	return nr;
+}
+
+/*
+ * Per cpu cache of free swap slots. Slots are allocated in batches so
+ * that swap_lock is taken once per SWAP_SLOTS_BATCH swap-outs, and so
+ * that consecutive swap-outs from one cpu get adjacent slots which can
+ * be written with a single bio.
+ *
+ * Cached slots are marked SWAP_HAS_CACHE without having a page in the
+ * swap cache. The caches are drained when a swap area is turned off, so
+ * that try_to_unuse() does not wait for them, and when a cpu goes offline,
+ * so that its slots are not lost until then.
+ */
+#define SWAP_SLOTS_BATCH	64
+
+struct swap_slots_cache {
+	struct mutex	alloc_lock;
+	int		nr;
+	int		cur;
+	swp_entry_t	slots[SWAP_SLOTS_BATCH];
+};
+
+static DEFINE_PER_CPU(struct swap_slots_cache, swap_slots_cache);
+bool swap_slots_cache_enabled __read_mostly;
+
+static void drain_swap_slots_cache(struct swap_slots_cache *cache)
+{
+	mutex_lock(&cache->alloc_lock);
+	while (cache->nr) {
+		swapcache_free(cache->slots[cache->cur++], NULL);
+		cache->nr--;
+	}
+	cache->cur = 0;
+	mutex_unlock(&cache->alloc_lock);
+}
+
+/*
+ * Return the slots cached by all cpus. Called after SWP_WRITEOK has been
+ * cleared on an area being turned off, so no refill can pick its slots
+ * again once this returns.
+ */
+static void drain_swap_slots_caches(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		drain_swap_slots_cache(&per_cpu(swap_slots_cache, cpu));
+}
+
+swp_entry_t get_swap_page(void)
+{
+	struct swap_slots_cache *cache;
+	swp_entry_t entry = { 0 };
+
+	if (!swap_slots_cache_enabled) {
+		get_swap_pages(1, &entry);
+		return entry;
+	}
+
+	/*
+	 * Preemption may move us to another cpu, the mutex keeps the
+	 * cache consistent, locality is all we want from the cpu here.
+	 */
+	cache = &per_cpu(swap_slots_cache, raw_smp_processor_id());
+	mutex_lock(&cache->alloc_lock);
+	if (!cache->nr) {
+		cache->cur = 0;
+		cache->nr = get_swap_pages(SWAP_SLOTS_BATCH, cache->slots);
+		count_vm_event(SWAP_SLOTS_REFILL);
+	}
+	if (cache->nr) {
+		entry = cache->slots[cache->cur++];
+		cache->nr--;
+	}
+	mutex_unlock(&cache->alloc_lock);
+
+	if (!entry.val)
+		get_swap_pages(1, &entry);
+	return entry;
+}
+
+static int swap_slots_cpu_notify(struct notifier_block *self,
+				 unsigned long action, void *hcpu)
+{
+	int cpu = (unsigned long)hcpu;
+
+	if (action == CPU_DEAD || action == CPU_DEAD_FROZEN)
+		drain_swap_slots_cache(&per_cpu(swap_slots_cache, cpu));
+	return NOTIFY_OK;
+}
+
+static int __init swap_slots_cache_init(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		mutex_init(&per_cpu(swap_slots_cache, cpu).alloc_lock);
+	hotcpu_notifier(swap_slots_cpu_notify, 0);
+	swap_slots_cache_enabled = true;
+	return 0;
+}
+__initcall(swap_slots_cache_init);
+
+/**
+ * __swp_swapcount - number of users of a swap entry, excluding the swap cache
+ * @entry: swap entry to look up
+ *
+ * Lockless and thus only a hint, used to skip readahead of free slots.
+ */
+int __swp_swapcount(swp_entry_t entry)
+{
+	struct swap_info_struct *si;
+	unsigned long type = swp_type(entry);
+	pgoff_t offset = swp_offset(entry);
+
+	if (type >= nr_swapfiles)
+		return 0;
+	si = swap_info[type];
+	if (!si || offset >= si->max)
+		return 0;
+	return swap_count(ACCESS_ONCE(si->swap_map[offset]));
 }
 
 /* The only caller of this function is now susupend routine */
@@ -1615,6 +1747,9 @@ SYSCALL_DEFINE1(swapoff, const char __user *, specialfile)
 	p->flags &= ~SWP_WRITEOK;
 	spin_unlock(&swap_lock);
 
+	/* Slots cached by other cpus would keep try_to_unuse() busy */
+	drain_swap_slots_caches();
+
 	oom_score_adj = test_set_oom_score_adj(OOM_SCORE_ADJ_MAX);
 	err = try_to_unuse(type);
 	test_set_oom_score_adj(oom_score_adj);
@@ -210,18 +210,18 @@ void truncate_inode_pages_range(struct address_space *mapping,
 				loff_t lstart, loff_t lend)
 {
 	const pgoff_t start = (lstart + PAGE_CACHE_SIZE-1) >> PAGE_CACHE_SHIFT;
-	pgoff_t end;
+	pgoff_t end = (lend >> PAGE_CACHE_SHIFT);
 	const unsigned partial = lstart & (PAGE_CACHE_SIZE - 1);
 	struct pagevec pvec;
 	pgoff_t next;
 	int i;
 
 	cleancache_flush_inode(mapping);
+	workingset_forget(mapping, start, end);
 	if (mapping->nrpages == 0)
 		return;
 
 	BUG_ON((lend & (PAGE_CACHE_SIZE - 1)) != (PAGE_CACHE_SIZE - 1));
-	end = (lend >> PAGE_CACHE_SHIFT);
 
 	pagevec_init(&pvec, 0);
 	next = start;
@@ -295,6 +295,8 @@ void truncate_inode_pages_range(struct address_space *mapping,
 		mem_cgroup_uncharge_end();
 	}
 	cleancache_flush_inode(mapping);
+	/* Reclaim may have evicted pages of the range in the meantime */
+	workingset_forget(mapping, start, end);
 }
 EXPORT_SYMBOL(truncate_inode_pages_range);
 
@@ -378,6 +380,7 @@ unsigned long invalidate_mapping_pages(struct address_space *mapping,
 		mem_cgroup_uncharge_end();
 		cond_resched();
 	}
+	workingset_forget(mapping, start, end);
 	return count;
 }
 EXPORT_SYMBOL(invalidate_mapping_pages);
@@ -509,6 +512,7 @@ int invalidate_inode_pages2_range(struct address_space *mapping,
 		cond_resched();
 	}
 	cleancache_flush_inode(mapping);
+	workingset_forget(mapping, start, end);
 	return ret;
 }
 EXPORT_SYMBOL_GPL(invalidate_inode_pages2_range);
@@ -395,9 +395,13 @@ typedef enum {
 /*
  * pageout is called by shrink_page_list() for each dirty page.
  * Calls ->writepage().
+ *
+ * Asynchronous swap-outs are gathered in *swap_plug, which the caller
+ * has to submit with swap_write_unplug(). It is submitted here before any
+ * other ->writepage(), which may need a bio from the same mempool.
  */
 static pageout_t pageout(struct page *page, struct address_space *mapping,
-			 struct scan_control *sc)
+			 struct scan_control *sc, struct bio **swap_plug)
 {
 	/*
 	 * If the page is dirty, only perform writeback if that write
@@ -446,6 +450,12 @@ static pageout_t pageout(struct page *page, struct address_space *mapping,
 			.for_reclaim = 1,
 		};
 
+		if (!PageSwapCache(page)) {
+			swap_write_unplug(*swap_plug);
+			*swap_plug = NULL;
+		} else if (!(sc->reclaim_mode & RECLAIM_MODE_SYNC))
+			wbc.swap_plug = swap_plug;
+
 		SetPageReclaim(page);
 		res = mapping->a_ops->writepage(page, &wbc);
 		if (res < 0)
@@ -530,6 +540,7 @@ static int __remove_mapping(struct address_space *mapping, struct page *page)
 
 		freepage = mapping->a_ops->freepage;
 
+		workingset_eviction(mapping, page);
 		__delete_from_page_cache(page);
 		spin_unlock_irq(&mapping->tree_lock);
 		mem_cgroup_uncharge_cache_page(page);
@@ -727,13 +738,15 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 	unsigned long nr_dirty = 0;
 	unsigned long nr_congested = 0;
 	unsigned long nr_reclaimed = 0;
+	struct bio *swap_plug = NULL;
+	LIST_HEAD(swap_pages);
+	struct page *page, *next;
 
 	cond_resched();
 
 	while (!list_empty(page_list)) {
 		enum page_references references;
 		struct address_space *mapping;
-		struct page *page;
 		int may_enter_fs;
 
 		cond_resched();
@@ -772,9 +785,11 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 			 * started.
 			 */
 			if ((sc->reclaim_mode & RECLAIM_MODE_SYNC) &&
-			    may_enter_fs)
+			    may_enter_fs) {
+				swap_write_unplug(swap_plug);
+				swap_plug = NULL;
 				wait_on_page_writeback(page);
-			else {
+			} else {
 				unlock_page(page);
 				goto keep_lumpy;
 			}
@@ -833,13 +848,18 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 				goto keep_locked;
 
 			/* Page is dirty, try to write it out here */
-			switch (pageout(page, mapping, sc)) {
+			switch (pageout(page, mapping, sc, &swap_plug)) {
 			case PAGE_KEEP:
 				nr_congested++;
 				goto keep_locked;
 			case PAGE_ACTIVATE:
 				goto activate_locked;
 			case PAGE_SUCCESS:
+				/* Possibly in swap_plug, see below */
+				if (PageWriteback(page) && PageSwapCache(page)) {
+					list_add(&page->lru, &swap_pages);
+					continue;
+				}
 				if (PageWriteback(page))
 					goto keep_lumpy;
 				if (PageDirty(page))
@@ -881,6 +901,8 @@ static unsigned long shrink_page_list(struct list_head *page_list,
 		 * Otherwise, leave the page on the LRU so it is swappable.
 		 */
 		if (page_has_private(page)) {
+			swap_write_unplug(swap_plug);
+			swap_plug = NULL;
 			if (!try_to_release_page(page, sc->gfp_mask))
 				goto activate_locked;
 			if (!mapping && page_count(page) == 1) {
@@ -946,6 +968,29 @@ keep_lumpy:
 		VM_BUG_ON(PageLRU(page) || PageUnevictable(page));
 	}
 
+	swap_write_unplug(swap_plug);
+
+	/*
+	 * Swap-outs to a RAM based device such as zram have completed by the
+	 * time they are submitted, but the batched ones were submitted only
+	 * now. Free those pages in this pass, as if written synchronously.
+	 */
+	list_for_each_entry_safe(page, next, &swap_pages, lru) {
+		list_del(&page->lru);
+		if (!PageWriteback(page) && trylock_page(page)) {
+			if (!PageDirty(page) && !PageWriteback(page) &&
+			    PageSwapCache(page) &&
+			    __remove_mapping(page_mapping(page), page)) {
+				__clear_page_locked(page);
+				nr_reclaimed++;
+				list_add(&page->lru, &free_pages);
+				continue;
+			}
+			unlock_page(page);
+		}
+		list_add(&page->lru, &ret_pages);
+	}
+
 	/*
 	 * Tag a zone as congested if all the dirty pages encountered were
 	 * backed by a congested BDI. In this case, reclaimers should just
@@ -726,15 +726,22 @@ const char * const vmstat_text[] = {
 	"pgpgout",
 	"pswpin",
 	"pswpout",
+	"pswpout_batched",
+	"pswpout_single",
+	"swap_slots_refill",
 
 	TEXTS_FOR_ZONES("pgalloc")
 
 	"pgfree",
 	"pgactivate",
 	"pgdeactivate",
+	"pcp_high_order_hit",
+	"pcp_high_order_miss",
 
 	"pgfault",
 	"pgmajfault",
+	"workingset_refault",
+	"workingset_activate",
 
 	TEXTS_FOR_ZONES("pgrefill")
 	TEXTS_FOR_ZONES("pgsteal")
@@ -763,6 +770,11 @@ const char * const vmstat_text[] = {
 	"compact_stall",
 	"compact_fail",
 	"compact_success",
+	"compact_success_retry",
+	"compact_direct_pages_moved",
+	"compact_daemon_wake",
+	"compact_proactive",
+	"compact_proactive_pages_moved",
 #endif
 
 #ifdef CONFIG_HUGETLB_PAGE
@@ -0,0 +1,251 @@
+/*
+ * linux/mm/workingset.c
+ *
+ * Workingset detection for the page cache.
+ *
+ * When a file page is reclaimed, a shadow entry remembering the mapping,
+ * the index and the time of eviction is stored. Time is measured by the
+ * zone's inactive_age, which advances on every file page eviction and
+ * activation, so that the difference between the age at refault and the
+ * age at eviction - the refault distance - is the minimum number of
+ * inactive list slots the page would have needed to stay resident.
+ *
+ * If that distance is no bigger than the active file list, the page could
+ * have stayed in memory had the active list been used as inactive space:
+ * it is part of the workingset and is activated right away on refault.
+ * Adding it to the active list counts as a rotation in the zone's reclaim
+ * statistics, which shifts scan pressure from file to anon pages.
+ *
+ * Shadow entries are kept in a fixed size hash table of small buckets
+ * rather than in the page cache radix tree, so that no page cache lookup
+ * has to know about them. When a bucket is full the oldest entry in it is
+ * replaced, and a hash collision can at worst activate a page that would
+ * otherwise have gone to the inactive list.
+ *
+ * Each address_space gets a generation number, from a global counter,
+ * when its first page is evicted, and the generation is part of the key.
+ * A new inode starts without one, so it never matches the shadows of an
+ * evicted inode that lived at the same address. Truncation and invalidation
+ * clear the shadows of small ranges one by one and, for larger ranges, drop
+ * the generation, which orphans all shadows of the mapping until they are
+ * replaced.
+ */
+
+#include <linux/mm.h>
+#include <linux/mmzone.h>
+#include <linux/fs.h>
+#include <linux/hash.h>
+#include <linux/init.h>
+#include <linux/spinlock.h>
+#include <linux/swap.h>
+#include <linux/vmalloc.h>
+#include <linux/vmstat.h>
+
+#define SHADOW_BUCKET_SIZE	8
+
+/* Larger ranges are forgotten by dropping the mapping's generation */
+#define SHADOW_FORGET_MAX	64
+
+/* Low bits of a shadow's eviction value identify the zone */
+#define SHADOW_ZONE_BITS	(NODES_SHIFT + ZONES_SHIFT)
+#define SHADOW_AGE_MASK		(~0UL >> SHADOW_ZONE_BITS)
+
+struct shadow_entry {
+	unsigned long key;		/* 0 if unused */
+	unsigned long eviction;		/* inactive_age << SHADOW_ZONE_BITS | zone */
+};
+
+struct shadow_bucket {
+	spinlock_t lock;
+	unsigned int hand;		/* next entry to replace */
+	struct shadow_entry entries[SHADOW_BUCKET_SIZE];
+};
+
+static struct shadow_bucket *shadow_table __read_mostly;
+static unsigned int shadow_hash_shift __read_mostly;
+static atomic_long_t shadow_last_gen;
+
+static unsigned long shadow_key(struct address_space *mapping,
+				unsigned long gen, pgoff_t index)
+{
+	unsigned long key;
+
+	key = hash_long((unsigned long)mapping, BITS_PER_LONG) ^
+	      hash_long(gen, BITS_PER_LONG) ^ index;
+	return hash_long(key, BITS_PER_LONG) | 1;
+}
+
+static struct shadow_bucket *shadow_bucket(unsigned long key)
+{
+	return &shadow_table[key >> (BITS_PER_LONG - shadow_hash_shift)];
+}
+
+/* Remove the entry for @key, returning its eviction value in @eviction */
+static bool shadow_take(unsigned long key, unsigned long *eviction)
+{
+	struct shadow_bucket *bucket = shadow_bucket(key);
+	unsigned long flags;
+	int i;
+
+	spin_lock_irqsave(&bucket->lock, flags);
+	for (i = 0; i < SHADOW_BUCKET_SIZE; i++) {
+		struct shadow_entry *entry = &bucket->entries[i];
+
+		if (entry->key == key) {
+			*eviction = entry->eviction;
+			entry->key = 0;
+			break;
+		}
+	}
+	spin_unlock_irqrestore(&bucket->lock, flags);
+	return i < SHADOW_BUCKET_SIZE;
+}
+
+static unsigned long pack_eviction(struct zone *zone)
+{
+	unsigned long eviction = atomic_long_read(&zone->inactive_age);
+
+	eviction = (eviction << NODES_SHIFT) | zone_to_nid(zone);
+	return (eviction << ZONES_SHIFT) | zone_idx(zone);
+}
+
+static struct zone *unpack_eviction(unsigned long eviction,
+				    unsigned long *age)
+{
+	int zid = eviction & ((1UL << ZONES_SHIFT) - 1);
+	int nid;
+
+	eviction >>= ZONES_SHIFT;
+	nid = eviction & ((1UL << NODES_SHIFT) - 1);
+	*age = eviction >> NODES_SHIFT;
+	return &NODE_DATA(nid)->node_zones[zid];
+}
+
+/**
+ * workingset_eviction - note the eviction of a page from the page cache
+ * @mapping: address space the page was mapped to
+ * @page: the page being evicted
+ *
+ * Called from reclaim, with @page locked and still in the page cache, and
+ * with the mapping's tree_lock held.
+ */
+void workingset_eviction(struct address_space *mapping, struct page *page)
+{
+	struct zone *zone = page_zone(page);
+	struct shadow_bucket *bucket;
+	struct shadow_entry *entry;
+	unsigned long key;
+
+	if (!shadow_table)
+		return;
+
+	atomic_long_inc(&zone->inactive_age);
+
+	while (!mapping->shadow_gen)
+		mapping->shadow_gen = atomic_long_inc_return(&shadow_last_gen);
+	key = shadow_key(mapping, mapping->shadow_gen, page->index);
+
+	bucket = shadow_bucket(key);
+	spin_lock(&bucket->lock);
+	entry = &bucket->entries[bucket->hand];
+	bucket->hand = (bucket->hand + 1) % SHADOW_BUCKET_SIZE;
+	entry->key = key;
+	entry->eviction = pack_eviction(zone);
+	spin_unlock(&bucket->lock);
+}
+
+/**
+ * workingset_refault - evaluate the refault of a previously evicted page
+ * @mapping: address space the page is being added to
+ * @index: page cache index of the page
+ *
+ * Returns %true if the page should be activated, %false otherwise.
+ */
+bool workingset_refault(struct address_space *mapping, pgoff_t index)
+{
+	unsigned long gen = ACCESS_ONCE(mapping->shadow_gen);
+	unsigned long eviction, refault, age, distance;
+	struct zone *zone;
+
+	if (!shadow_table || !gen)
+		return false;
+
+	if (!shadow_take(shadow_key(mapping, gen, index), &eviction))
+		return false;
+
+	zone = unpack_eviction(eviction, &age);
+	refault = atomic_long_read(&zone->inactive_age);
+	distance = (refault - age) & SHADOW_AGE_MASK;
+
+	count_vm_event(WORKINGSET_REFAULT);
+	if (distance <= zone_page_state(zone, NR_ACTIVE_FILE)) {
+		count_vm_event(WORKINGSET_ACTIVATE);
+		return true;
+	}
+	return false;
+}
+
+/**
+ * workingset_forget - drop the shadow entries of a range of a mapping
+ * @mapping: address space being truncated or invalidated
+ * @start: first page cache index of the range
+ * @end: last page cache index of the range, inclusive
+ *
+ * Data that shows up in the range later has nothing to do with the pages
+ * that were evicted from it, and must not be activated on their account.
+ */
+void workingset_forget(struct address_space *mapping, pgoff_t start,
+		       pgoff_t end)
+{
+	unsigned long gen = ACCESS_ONCE(mapping->shadow_gen);
+	unsigned long eviction;
+	pgoff_t index;
+
+	if (!shadow_table || !gen)
+		return;
+
+	if (end >= start && end - start < SHADOW_FORGET_MAX) {
+		for (index = start; index <= end; index++)
+			shadow_take(shadow_key(mapping, gen, index), &eviction);
+		return;
+	}
+
+	spin_lock_irq(&mapping->tree_lock);
+	mapping->shadow_gen = 0;
+	spin_unlock_irq(&mapping->tree_lock);
+}
+
+/**
+ * workingset_activation - note a page activation
+ * @page: page that is being activated
+ */
+void workingset_activation(struct page *page)
+{
+	atomic_long_inc(&page_zone(page)->inactive_age);
+}
+
+static int __init workingset_init(void)
+{
+	unsigned long nr_entries;
+	unsigned int i;
+
+	/*
+	 * Refault distances beyond the size of the file LRUs are not
+	 * interesting, so track about a quarter of memory worth of evictions.
+	 */
+	nr_entries = max(totalram_pages / 4, 1024UL);
+	shadow_hash_shift = ilog2(nr_entries / SHADOW_BUCKET_SIZE);
+
+	shadow_table = vzalloc(sizeof(*shadow_table) << shadow_hash_shift);
+	if (!shadow_table) {
+		printk(KERN_WARNING "workingset: no memory for shadow entries\n");
+		return -ENOMEM;
+	}
+	for (i = 0; i < (1U << shadow_hash_shift); i++)
+		spin_lock_init(&shadow_table[i].lock);
+
+	printk(KERN_INFO "workingset: %u shadow entries\n",
+	       SHADOW_BUCKET_SIZE << shadow_hash_shift);
+	return 0;
+}
+module_init(workingset_init);